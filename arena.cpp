@@ -0,0 +1,92 @@
+#ifndef ARENA_CPP
+#define ARENA_CPP
+#include <bits/stdc++.h>
+using namespace std;
+
+// Arena Allocator:
+// Bump allocator for AST nodes. Objects are placed back to back in large
+// blocks and are never destroyed one by one: dropping (or reset()ing) the
+// arena releases everything at once. So only put trivially-destructible data
+// in here (nodes hold string_views and ArenaSpans, never std::string/vector).
+
+// a fixed-size array living in an Arena, e.g. the statements of a block
+template<class T>
+struct ArenaSpan{
+    T *items = nullptr;
+    uint32_t count = 0;
+
+    size_t size() const{ return count; }
+    bool empty() const{ return count == 0; }
+    T *begin() const{ return items; }
+    T *end() const{ return items + count; }
+    T &operator[](size_t i) const{ return items[i]; }
+};
+
+class Arena{
+    vector<unique_ptr<char[]>> blocks;
+    char *cur = nullptr;
+    char *limit = nullptr;
+    size_t nextBlockSize = 64 << 10;
+    size_t used = 0;
+
+    void newBlock(size_t atLeast){
+        size_t size = max(nextBlockSize,atLeast);
+        nextBlockSize = min<size_t>(nextBlockSize * 2,8 << 20); // grow, but don't overshoot by much
+        blocks.push_back(unique_ptr<char[]>(new char[size])); // not zeroed
+        cur = blocks.back().get();
+        limit = cur + size;
+    }
+public:
+    Arena(){}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void *allocate(size_t bytes,size_t align){
+        uintptr_t p = ((uintptr_t)cur + align - 1) & ~(uintptr_t)(align - 1);
+        if(!cur || p + bytes > (uintptr_t)limit){
+            newBlock(bytes + align);
+            p = ((uintptr_t)cur + align - 1) & ~(uintptr_t)(align - 1);
+        }
+        cur = (char*)(p + bytes);
+        used += bytes;
+        return (void*)p;
+    }
+
+    template<class T,class... Args>
+    T *make(Args&&... args){
+        return new (allocate(sizeof(T),alignof(T))) T(forward<Args>(args)...);
+    }
+
+    // copy items[from..] into one contiguous arena array
+    template<class T>
+    ArenaSpan<T> copy(const vector<T> &items,size_t from = 0){
+        ArenaSpan<T> span;
+        span.count = (uint32_t)(items.size() - from);
+        if(span.count == 0) return span;
+        span.items = (T*)allocate(sizeof(T) * span.count,alignof(T));
+        uninitialized_copy(items.begin() + from,items.end(),span.items);
+        return span;
+    }
+
+    string_view copy(string_view text){
+        char *p = (char*)allocate(text.size(),1);
+        memcpy(p,text.data(),text.size());
+        return string_view(p,text.size());
+    }
+
+    // forget every object but keep the largest block for reuse (streaming: one statement at a time)
+    void reset(){
+        if(blocks.empty()) return;
+        size_t lastSize = limit - blocks.back().get();
+        unique_ptr<char[]> keep = move(blocks.back());
+        blocks.clear();
+        blocks.push_back(move(keep));
+        cur = blocks.back().get();
+        limit = cur + lastSize;
+        used = 0;
+    }
+
+    size_t bytesUsed() const{ return used; }
+};
+
+#endif
@@ -0,0 +1,343 @@
+// Benchmarks
+// build: g++ -O2 -pthread bench.cpp -o bench
+// run:   ./bench [corpus options]   time each stage on a synthetic program
+//        ./bench --kernels [MB]     scan kernels and parallel lexing on MB-sized inputs
+//
+// corpus options (how many of each construct; every count is multiplied by --scale):
+//   --scale F    default 1
+//   --decls N    `int vN = 42;` style declarations          default 200000
+//   --ifs N      nested if / else if / else blocks          default 2000
+//   --depth N    nesting depth of each if block             default 20
+//   --couts N    `cout << ... << endl;` statements           default 20000
+//   --chain N    parts in each cout chain                   default 16
+//   --exprs N    assignments of long arithmetic expressions default 20000
+//   --terms N    operands in each arithmetic expression     default 32
+//   --seed N     default 1
+//   --dump FILE  also write the generated program to FILE
+#include <chrono>
+#include <sys/resource.h>
+#define CODEGEN_NO_MAIN
+#include "codegen.cpp"
+#include "flatast.cpp"
+
+double secondsSince(chrono::steady_clock::time_point start){
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// repeat a snippet until the text is at least `bytes` long
+string repeatTo(const string &snippet,size_t bytes){
+    string text;
+    text.reserve(bytes + snippet.size());
+    while(text.size() < bytes) text += snippet;
+    return text;
+}
+
+// Raw kernels: the scanning loops on their own, over lines / runs of `run` bytes
+void benchRawKernels(size_t bytes,size_t run){
+    string lines = repeatTo(string(run - 1,'x') + "\n",bytes);
+    string spaces = repeatTo(string(run - 1,' ') + "x",bytes);
+    printf("== raw scan kernels (%zu-byte runs) ==\n",run);
+    double scalarFind = 0,scalarSkip = 0;
+    for(const ScanKernels *kernels : availableKernels()){
+        auto start = chrono::steady_clock::now();
+        size_t hits = 0;
+        for(size_t pos = 0 ; pos < lines.size() ; ++pos,++hits)
+            pos += kernels->findByte(lines.data() + pos,lines.size() - pos,'\n');
+        double findSecs = secondsSince(start);
+
+        start = chrono::steady_clock::now();
+        for(size_t pos = 0 ; pos < spaces.size() ; ++pos,++hits)
+            pos += kernels->skipSpaces(spaces.data() + pos,spaces.size() - pos);
+        double skipSecs = secondsSince(start);
+
+        if(kernels == &scalarKernels){ scalarFind = findSecs; scalarSkip = skipSecs; }
+        printf("  %-7s findByte %9.1f MB/s (x%.2f)   skipSpaces %9.1f MB/s (x%.2f)   [%zu]\n",kernels->name,
+               lines.size() / findSecs / 1e6,scalarFind / findSecs,spaces.size() / skipSecs / 1e6,scalarSkip / skipSecs,hits);
+    }
+}
+
+// Scan kernels: lex comment-, string- and whitespace-heavy sources with each
+// kernel set and report MB/s, so the SIMD paths can be compared to scalar.
+void benchScanKernels(size_t bytes){
+    vector<pair<string,string>> corpora = {
+        {"comments","// the quick brown fox jumps over the lazy dog, then does it again and again\nint x = 1;\n"},
+        {"strings","cout << \"a fairly long string literal that the lexer has to walk over byte by byte\" << endl;\n"},
+        {"whitespace","x = x + 1;\n                                                                \n\t\t\t\t\t\t\t\t\n"},
+    };
+    cout << "== lexer scan kernels ==\n";
+    for(auto &corpus : corpora){
+        string text = repeatTo(corpus.second,bytes);
+        double scalarSecs = 0;
+        for(const ScanKernels *kernels : availableKernels()){
+            Lexer lexer(text);
+            lexer.setScanKernels(*kernels);
+            auto start = chrono::steady_clock::now();
+            size_t count = lexer.tokenize().size();
+            double secs = secondsSince(start);
+            if(kernels == &scalarKernels) scalarSecs = secs;
+            printf("  %-10s %-7s %9.1f MB/s  %10zu tokens  x%.2f vs scalar\n",corpus.first.c_str(),kernels->name,
+                   text.size() / secs / 1e6,count,scalarSecs / secs);
+        }
+    }
+}
+
+// Parallel lexing: tokenize(threads) against the serial tokenize() on the same text
+void benchParallelLex(size_t bytes){
+    SourceBuffer source(repeatTo("int x = 10;\nif (x > 5) { cout << \"x // not a comment\" << endl; } // done\nx = x - 1;\n",bytes));
+    cout << "== parallel lexing ==\n";
+    double serialSecs = 0;
+    for(unsigned threads : {1u,2u,4u,8u,16u,32u}){
+        if(threads > 1 && threads > thread::hardware_concurrency()) break;
+        Lexer lexer(source);
+        auto start = chrono::steady_clock::now();
+        size_t count = (threads == 1 ? lexer.tokenize() : lexer.tokenize(threads)).size();
+        double secs = secondsSince(start);
+        if(threads == 1) serialSecs = secs;
+        printf("  %2u threads %9.1f MB/s  %10zu tokens  x%.2f vs serial\n",threads,source.view().size() / secs / 1e6,count,serialSecs / secs);
+    }
+}
+
+// Synthetic corpus in the supported subset
+struct CorpusOptions{
+    double scale = 1;
+    size_t decls = 200000, ifs = 2000, depth = 20, couts = 20000, chain = 16, exprs = 20000, terms = 32;
+    unsigned seed = 1;
+};
+
+void genIf(string &out,size_t depth,mt19937 &rng,const string &pad){
+    out += pad + "if (x" + to_string(depth) + " > " + to_string(rng() % 100) + ") {\n";
+    if(depth > 1) genIf(out,depth - 1,rng,pad + "    ");
+    else out += pad + "    y = y + 1;\n";
+    out += pad + "} else if (x" + to_string(depth) + " == " + to_string(rng() % 100) + ") {\n";
+    out += pad + "    y = y - " + to_string(rng() % 10) + ";\n";
+    out += pad + "} else {\n";
+    out += pad + "    cout << \"depth \" << y << endl;\n";
+    out += pad + "}\n";
+}
+
+string generateCorpus(const CorpusOptions &opt){
+    mt19937 rng(opt.seed);
+    auto count = [&](size_t n){ return (size_t)(n * opt.scale); };
+    const char *ops[] = {" + "," - "," * "," / "};
+    string out;
+    for(size_t i = 0 ; i < count(opt.decls) ; ++i){
+        if(i % 4 == 3) out += "float f" + to_string(i) + " = " + to_string(rng() % 1000) + ".5;\n";
+        else out += "int v" + to_string(i) + " = " + to_string(rng() % 1000) + ";\n";
+    }
+    for(size_t i = 0 ; i < count(opt.ifs) ; ++i) genIf(out,opt.depth,rng,"");
+    for(size_t i = 0 ; i < count(opt.couts) ; ++i){
+        out += "cout";
+        for(size_t k = 0 ; k < opt.chain ; ++k){
+            if(k % 2 == 0) out += " << \"part " + to_string(k) + " \"";
+            else out += " << v" + to_string(rng() % 1000);
+        }
+        out += " << endl;\n";
+    }
+    for(size_t i = 0 ; i < count(opt.exprs) ; ++i){
+        out += "x = (v" + to_string(rng() % 1000);
+        for(size_t k = 1 ; k < opt.terms ; ++k){
+            out += ops[rng() % 4];
+            if(k % 3 == 0) out += "(" + to_string(rng() % 100 + 1) + " - y)";
+            else out += "v" + to_string(rng() % 1000);
+        }
+        out += ");\n";
+    }
+    for(size_t i = 0 ; i < count(opt.ifs) ; ++i){
+        out += "for (int i = 0; i < " + to_string(rng() % 100) + "; i++) {\n    x = x + i;\n}\n";
+        out += "while (x > 0) {\n    x = x - 1;\n}\n";
+    }
+    return out;
+}
+
+// AST size, for nodes/s
+size_t countNodes(const ExprAST &e){
+    return visitNode(e,Overloaded{
+        [](const BinaryExprAST &b){ return 1 + countNodes(*b.left) + countNodes(*b.right); },
+        [](const UnaryExprAST &u){ return 1 + countNodes(*u.operand); },
+        [](const auto &){ return (size_t)1; },
+    });
+}
+
+template<class List> size_t countNodes(const List &body);
+
+size_t countNodes(const StatementAST &s){
+    return visitNode(s,Overloaded{
+        [](const VarDeclAST &v){ return 1 + (v.initialValue ? countNodes(*v.initialValue) : 0); },
+        [](const AssignmentAST &a){ return 1 + countNodes(*a.value); },
+        [](const CoutStatementAST &c){
+            size_t n = 1;
+            for(auto &p : c.parts) n += countNodes(*p);
+            return n;
+        },
+        [](const IfStatementAST &i){
+            size_t n = 1 + countNodes(*i.condition) + countNodes(i.thenBody) + countNodes(i.elseBody);
+            for(auto &eif : i.elseIfBlocks) n += (eif.condition ? countNodes(*eif.condition) : 0) + countNodes(eif.body);
+            return n;
+        },
+        [](const ForStatementAST &f){
+            size_t n = 1 + countNodes(f.body);
+            if(f.init) n += countNodes(*f.init);
+            if(f.condition) n += countNodes(*f.condition);
+            if(f.step) n += countNodes(static_cast<const StatementAST&>(*f.step));
+            return n;
+        },
+        [](const WhileStatementAST &w){ return 1 + countNodes(*w.condition) + countNodes(w.body); },
+        [](const ErrorStatementAST &){ return (size_t)1; },
+    });
+}
+
+template<class List> size_t countNodes(const List &body){
+    size_t n = 0;
+    for(auto &s : body) n += countNodes(*s);
+    return n;
+}
+
+// the same count over a FlatAST, following child indices from the roots
+size_t countNodes(const FlatAST &flat){
+    vector<uint32_t> work(flat.roots.rbegin(),flat.roots.rend());
+    size_t n = 0;
+    auto pushList = [&](uint32_t at){ for(uint32_t id : flat.list(at)) if(id != NoNode) work.push_back(id); };
+    while(!work.empty()){
+        const FlatNode &node = flat.nodes[work.back()];
+        work.pop_back();
+        switch(node.kind){
+            case NodeKind::Binary: work.push_back(node.b); work.push_back(node.a); break;
+            case NodeKind::Unary: work.push_back(node.a); break;
+            case NodeKind::VarDecl: if(node.c != NoNode) work.push_back(node.c); break;
+            case NodeKind::Assignment: work.push_back(node.b); break;
+            case NodeKind::Cout: pushList(node.a); break;
+            case NodeKind::If: pushList(node.c); pushList(node.b); work.push_back(node.a); break;
+            case NodeKind::Elif: pushList(node.b); if(node.a != NoNode) work.push_back(node.a); continue; // arms aren't nodes in the tree
+            case NodeKind::Else: pushList(node.b); continue;
+            case NodeKind::For: pushList(node.b); pushList(node.a); break;
+            case NodeKind::While: pushList(node.b); work.push_back(node.a); break;
+            default: break;
+        }
+        ++n;
+    }
+    return n;
+}
+
+double peakRssMB(){
+    struct rusage usage;
+    getrusage(RUSAGE_SELF,&usage);
+    return usage.ru_maxrss / 1024.0; // ru_maxrss is in KB on Linux
+}
+
+// Per-stage timings: Lexer::tokenize, Parser::parse, CodeGenrator::generate, flatten() and
+// AST teardown, then the whole translation again with runPipeline() and runParallel()
+void benchStages(const CorpusOptions &opt,const string &dumpPath){
+    auto start = chrono::steady_clock::now();
+    SourceBuffer source(generateCorpus(opt));
+    double genSecs = secondsSince(start);
+    double mb = source.view().size() / 1e6;
+    if(!dumpPath.empty()) ofstream(dumpPath) << source.view();
+    printf("== stages: %.1f MB corpus (generated in %.2fs) ==\n",mb,genSecs);
+    printf("  %-10s %8s %10s %14s %14s %12s\n","stage","secs","MB/s","tokens/s","nodes/s","peak RSS");
+
+    Lexer lexer(source);
+    start = chrono::steady_clock::now();
+    TokenStream tokens = lexer.tokenize();
+    double lexSecs = secondsSince(start);
+    size_t tokenCount = tokens.size();
+    printf("  %-10s %8.3f %10.1f %14.0f %14s %9.1f MB\n","tokenize",lexSecs,mb / lexSecs,tokenCount / lexSecs,"-",peakRssMB());
+
+    auto ctx = make_unique<ParseContext>();
+    Parser parser(move(tokens),*ctx);
+    start = chrono::steady_clock::now();
+    ProgramAST program = parser.parse();
+    double parseSecs = secondsSince(start);
+    size_t nodes = countNodes(program);
+    printf("  %-10s %8.3f %10.1f %14.0f %14.0f %9.1f MB\n","parse",parseSecs,mb / parseSecs,tokenCount / parseSecs,nodes / parseSecs,peakRssMB());
+
+    CodeGenrator gen(ctx->symbols);
+    start = chrono::steady_clock::now();
+    string python = gen.generate(program);
+    double genPySecs = secondsSince(start);
+    printf("  %-10s %8.3f %10.1f %14s %14.0f %9.1f MB   (%.1f MB of Python)\n","generate",genPySecs,mb / genPySecs,"-",nodes / genPySecs,peakRssMB(),python.size() / 1e6);
+
+    // the flat layout: build it, then walk both trees once
+    start = chrono::steady_clock::now();
+    FlatAST flat = flatten(program);
+    double flattenSecs = secondsSince(start);
+    double flatMB = (flat.nodes.size() * sizeof(FlatNode) + flat.lists.size() * sizeof(uint32_t)) / 1e6;
+    printf("  %-10s %8.3f %10s %14s %14.0f %9.1f MB   (%.1f MB flat vs %.1f MB of arena nodes)\n","flatten",flattenSecs,"-","-",
+           nodes / flattenSecs,peakRssMB(),flatMB,ctx->arena.bytesUsed() / 1e6);
+    start = chrono::steady_clock::now();
+    size_t treeCount = countNodes(program);
+    double treeWalkSecs = secondsSince(start);
+    start = chrono::steady_clock::now();
+    size_t flatCount = countNodes(flat);
+    double flatWalkSecs = secondsSince(start);
+    printf("  %-10s %8.3f %10s %14s %14.0f   tree walk %.3fs (x%.2f)%s\n","flat walk",flatWalkSecs,"-","-",nodes / flatWalkSecs,
+           treeWalkSecs,treeWalkSecs / flatWalkSecs,treeCount == flatCount ? "" : "  NODE COUNT MISMATCH");
+    flat = FlatAST();
+
+    start = chrono::steady_clock::now();
+    ctx.reset(); // the arena owns every node
+    program = ProgramAST();
+    double freeSecs = secondsSince(start);
+    printf("  %-10s %8.3f %10s %14s %14.0f\n","free AST",freeSecs,"-","-",nodes / freeSecs);
+
+    double total = lexSecs + parseSecs + genPySecs;
+    printf("  %-10s %8.3f %10.1f   %zu tokens, %zu nodes\n","total",total,mb / total,tokenCount,nodes);
+
+    // the same translation with lexer, parser, codegen and writer on their own threads
+    Lexer pipeLexer(source);
+    ParseContext pipeCtx;
+    CodeGenrator pipeGen(pipeCtx.symbols);
+    ofstream devNull("/dev/null");
+    start = chrono::steady_clock::now();
+    runPipeline(pipeLexer,pipeCtx,devNull,[&](const StatementAST &stmt,string &out){ pipeGen.generateStatement(stmt,out); });
+    double pipeSecs = secondsSince(start);
+    printf("  %-10s %8.3f %10.1f   x%.2f vs total, %u hardware threads\n","pipelined",pipeSecs,mb / pipeSecs,total / pipeSecs,thread::hardware_concurrency());
+
+    // and split into runs of top-level statements, parsed and emitted on every core (tokens from the serial lexer)
+    Lexer parLexer(source);
+    TokenStream parTokens = parLexer.tokenize();
+    ParseContext parCtx;
+    ParallelOptions parOptions;
+    start = chrono::steady_clock::now();
+    runParallel(parTokens,parCtx,devNull,[](ProgramAST &program,ParseContext &ctx,string &out){
+        CodeGenrator gen(ctx.symbols);
+        for(auto *stmt : program) gen.generateStatement(*stmt,out);
+    },parOptions);
+    double parSecs = secondsSince(start);
+    printf("  %-10s %8.3f %10.1f   x%.2f vs parse + generate, %u threads\n","parallel",parSecs,mb / parSecs,(parseSecs + genPySecs) / parSecs,parOptions.threads);
+}
+
+int main(int argc,char **argv){
+    CorpusOptions opt;
+    string dumpPath;
+    bool kernels = false;
+    size_t megabytes = 64;
+    for(int i = 1 ; i < argc ; ++i){
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "--kernels"){
+            kernels = true;
+            if(hasValue && isdigit((unsigned char)argv[i+1][0])) megabytes = stoul(argv[++i]);
+        }
+        else if(!hasValue){ cerr << "missing value for " << arg << endl; return 1; }
+        else if(arg == "--scale") opt.scale = stod(argv[++i]);
+        else if(arg == "--decls") opt.decls = stoul(argv[++i]);
+        else if(arg == "--ifs") opt.ifs = stoul(argv[++i]);
+        else if(arg == "--depth") opt.depth = max<size_t>(1,stoul(argv[++i]));
+        else if(arg == "--couts") opt.couts = stoul(argv[++i]);
+        else if(arg == "--chain") opt.chain = stoul(argv[++i]);
+        else if(arg == "--exprs") opt.exprs = stoul(argv[++i]);
+        else if(arg == "--terms") opt.terms = max<size_t>(1,stoul(argv[++i]));
+        else if(arg == "--seed") opt.seed = stoul(argv[++i]);
+        else if(arg == "--dump") dumpPath = argv[++i];
+        else { cerr << "unknown option " << arg << endl; return 1; }
+    }
+
+    if(kernels){
+        benchRawKernels(megabytes << 20,16);
+        benchRawKernels(megabytes << 20,256);
+        benchScanKernels(megabytes << 20);
+        benchParallelLex(megabytes << 20);
+    }
+    else benchStages(opt,dumpPath);
+    return 0;
+}
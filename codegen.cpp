@@ -1,197 +1,430 @@
+#ifndef CODEGEN_CPP
+#define CODEGEN_CPP
 #include <memory>
 #include <stdexcept>
 #include <fstream>
-#include <sstream>
 #include "parser.cpp"
+#include "pipeline.cpp"
+#include "parallel.cpp"
+#include "optimize.cpp"
+
+// Code Generator:
+// Every helper appends to one output string owned by the caller; nothing builds
+// a temporary string per node or per line, so the work is linear in the output.
+// The indentation of each pending statement travels with it on the work stack
+// and is written as a run of spaces when its line starts.
+
+struct CodegenOptions{
+    // Python that runs faster under CPython: the program becomes the body of main(),
+    // so its variables are locals instead of module globals, print and range are
+    // read through local aliases, and expressions keep only the parentheses that
+    // Python's precedence needs
+    bool fastPython = false;
+};
 
 class CodeGenrator{
 private:
-    string indent(int n);
-    string exprToPy(const ExprAST &expr);
-    string varDeclToPy(const VarDeclAST &v);
-    string assignToPy(const AssignmentAST &a);
-    string coutToPy(const CoutStatementAST &c);
-    string ifToPy(const IfStatementAST &i , int indentLevel);
-    string forToPy(const ForStatementAST &f , int indentLevel);
-    string whileToPy(const WhileStatementAST &w, int indentLevel);
-    string toPython(const StatementAST &stmt,int indentLevel);
+    const SymbolTable &symbols; // spells out the names and literals in the AST
+    CodegenOptions options;
+    void indent(int n,string &out);
+    void exprToPy(const ExprAST &expr,string &out);
+    void varDeclToPy(const VarDeclAST &v,string &out);
+    void assignToPy(const AssignmentAST &a,string &out);
+    void coutToPy(const CoutStatementAST &c,string &out);
+    bool forRangeToPy(const ForStatementAST &f , int indentLevel , string &out);
+
+    // pending output of toPython(): a statement, or a line that goes between nested bodies
+    struct EmitItem{
+        enum Kind : uint8_t { Statement , Elif , Else , Pass , Newline } kind;
+        int indentLevel;
+        const StatementAST *stmt;
+        const ExprAST *condition; // Elif
+    };
+    vector<EmitItem> work;
+    void pushBody(const StatementList &body,int indentLevel);
+    void toPython(const StatementAST &stmt,int indentLevel,string &out);
 public:
+    explicit CodeGenrator(const SymbolTable &syms,CodegenOptions opt = {}):symbols(syms),options(opt){}
     string generate(const ProgramAST &program);
+    void generate(const ProgramAST &program,ostream &sink); // written out in large chunks
+    // what goes before the first and after the last statement; generate() adds them itself,
+    // code that emits statement by statement writes them around the statements
+    void beginProgram(string &out);
+    void endProgram(string &out);
+    string generateStatement(const StatementAST &stmt); // one top-level statement, for streaming
+    void generateStatement(const StatementAST &stmt,string &out); // same, appended to out
 };
 
-string CodeGenrator::indent(int n){ // string consisting of n spaces
-    return string(n,' ');
+// Python on its way to a file: statements are appended to one reused buffer,
+// which is written out whenever it passes flushAt bytes
+class ChunkedWriter{
+    ostream &sink;
+    string buf;
+    size_t flushAt;
+public:
+    explicit ChunkedWriter(ostream &s,size_t chunkBytes = 1 << 20):sink(s),flushAt(chunkBytes){ buf.reserve(chunkBytes + (chunkBytes >> 2)); }
+    ~ChunkedWriter(){ flush(); }
+    string &buffer(){ return buf; }
+    void statementDone(){ if(buf.size() >= flushAt) flush(); } // call between statements
+    void flush(){
+        sink.write(buf.data(),buf.size());
+        buf.clear(); // keeps the capacity
+    }
+};
+
+void CodeGenrator::indent(int n,string &out){ // n spaces
+    out.append(n,' ');
 }
 
-string CodeGenrator::exprToPy(const ExprAST &expr){
-    if(auto n = dynamic_cast<const NumberExprAST*>(&expr)) return n->toPython();
-    else if (auto v = dynamic_cast<const VariableExprAST*>(&expr)) return v->toPython();
-    else if (auto s = dynamic_cast<const StringLiteralExprAST*>(&expr)) return s->toPython();
-    else if (auto b = dynamic_cast<const BinaryExprAST*>(&expr)) return b->toPython();
-    else return "/*unkown_expr*/";
+void CodeGenrator::exprToPy(const ExprAST &expr,string &out){
+    exprToPython(expr,symbols,out,options.fastPython); // dispatches on each node's kind
 }
 
 // varDecl to Py  e.g. int x = 10; => "x = 10"  ,  "int y"; => "y = None"
-string CodeGenrator::varDeclToPy(const VarDeclAST &v){
-    if(v.initialValue) return v.varName + " = " + v.initialValue->toPython();
-    else return v.varName + " = None"; 
+void CodeGenrator::varDeclToPy(const VarDeclAST &v,string &out){
+    out += symbols[v.varName];
+    out += " = ";
+    if(v.initialValue) exprToPy(*v.initialValue,out);
+    else out += "None";
 }
 
 //assignToPy e.g. x = 5 =>same
-string CodeGenrator::assignToPy(const AssignmentAST&a){
-    return a.varName +" = "+a.value->toPython();
+void CodeGenrator::assignToPy(const AssignmentAST&a,string &out){
+    out += symbols[a.varName];
+    out += " = ";
+    exprToPy(*a.value,out);
 }
 
 // coutToPy e.g. cout << "Hi" << x << endl; => print("Hi",x)
-string CodeGenrator::coutToPy(const CoutStatementAST &c){
-    ostringstream ss;
-    ss << "print(";
+void CodeGenrator::coutToPy(const CoutStatementAST &c,string &out){
+    out += options.fastPython ? "__print(" : "print(";
     for(size_t i = 0 ; i < c.parts.size();++i){
-        ss << c.parts[i]->toPython();
-        if(i < c.parts.size() -1) ss << ", ";
-    }
-    ss << ")";
-    return ss.str();
-}
-
-//ifToPy
-// 1. emit: indent + "if" + condition + ":\n"
-// 2. For each stmt in then Body: recursively convert with idndent 4
-// 3. For each else-if block : emit "elif cond: " and its body
-// 4. If elseBody exists: emit "else: " and its body
-string CodeGenrator::ifToPy(const IfStatementAST &i , int indentLevel){
-    ostringstream ss;
-    string pad = indent(indentLevel);
-    // Emit the 'if' line
-    ss << pad << "if " << i.condition->toPython() << ":\n";
-
-    //Then-block: each statement inside thenBody is indented furthur
-    for(auto &s: i.thenBody) ss << toPython(*s,indentLevel+4) << "\n";
-    
-    //Else-if block-emit as 'elif'
-    for(auto &eif:i.elseIfBlocks){
-        ss << pad << "elif " << eif.first->toPython() << ":\n";
-        for(auto &s:eif.second) ss << toPython(*s,indentLevel+4) << "\n";
-    }
-
-    // Else block
-    if(!i.elseBody.empty()){
-        ss << pad << "else:\n";
-        for(auto &s:i.elseBody) ss << toPython(*s,indentLevel + 4) << "\n";
-    }
-    return ss.str();
-}
-
-//forToPy
-string CodeGenrator::forToPy(const ForStatementAST &f , int indentLevel){
-    string pad = indent(indentLevel);
-
-    string init = f.init;
-    string cond = f.condition;
-    string inc = f.increment;
-
-    //inline helper to trim whitespace
-    auto trim =[](string t){
-        while(!t.empty() && isspace((unsigned char)t.front()) ) t.erase(t.begin());
-        while(!t.empty() && isspace((unsigned char)t.back())) t.pop_back();
-        return t;
-    };
-    init = trim(init);
-    cond = trim(cond);
-    inc = trim(inc);
+        exprToPy(*c.parts[i],out);
+        if(i < c.parts.size() -1) out += ", ";
+    }
+    out += ")";
+}
 
-    string var,start,endExpr;
-    size_t eq = init.find('=');
+// integer literal value of e, if it is one
+static bool intLiteral(const ExprAST *e,const SymbolTable &symbols,long long &value){
+    auto n = nodeAs<NumberExprAST>(e);
+    if(!n) return false;
+    string_view text = symbols[n->value];
+    if(text.empty() || text.size() > 18) return false;
+    value = 0;
+    for(char c : text){
+        if(c < '0' || c > '9') return false; // e.g. 2.5
+        value = value * 10 + (c - '0');
+    }
+    return true;
+}
 
-    //Extract variable and starting value (if pattern contains '=')
-    if(eq != string::npos){
-        string left = trim(init.substr(0,eq));   // left part e.g. "int i"
-        string right = trim(init.substr(eq+1));  // right part e.g. "0"
+// forRangeToPy e.g. for (int i = 0; i <= n; i += 2) => for i in range(0, (n + 1), 2):
+// Only counted loops fit range(): a declared int loop variable with a start value, a step
+// of i += k / i -= k with a literal k, and a condition comparing i against the end
+// in the step's direction. Anything else returns false and becomes a while loop.
+bool CodeGenrator::forRangeToPy(const ForStatementAST &f , int indentLevel , string &out){
+    // (a loop over an outer variable stays a while loop: after range() it would
+    // hold the last value, not the one that failed the condition)
+    auto decl = nodeAs<VarDeclAST>(f.init);
+    if(!decl || !decl->initialValue || symbols[decl->varType] != "int") return false;
+    Symbol var = decl->varName;
+    const ExprAST *start = decl->initialValue;
+    if(!f.step || f.step->varName != var) return false;
 
-        // remove "int" or "float" if present
-        if(left.find("int ") == 0) left = left.substr(4);
-        else if(left.find("float ") == 0) left = left.substr(6);
+    // step: the parser spells every update as i = (i + k) or i = (i - k)
+    auto inc = nodeAs<BinaryExprAST>(f.step->value);
+    auto incVar = inc ? nodeAs<VariableExprAST>(inc->left) : nullptr;
+    long long step;
+    if(!incVar || incVar->name != var || !intLiteral(inc->right,symbols,step) || step == 0) return false;
+    if(inc->op == BinaryOp::Sub) step = -step;
+    else if(inc->op != BinaryOp::Add) return false;
 
-        var = trim(left);
-        start = right;
+    // condition: i < end, i <= end (end + 1), i > end, i >= end (end - 1)
+    auto cond = nodeAs<BinaryExprAST>(f.condition);
+    auto condVar = cond ? nodeAs<VariableExprAST>(cond->left) : nullptr;
+    if(!condVar || condVar->name != var) return false;
+    int adjust;
+    switch(cond->op){
+        case BinaryOp::Less: adjust = 0; if(step < 0) return false; break;
+        case BinaryOp::LessEqual: adjust = 1; if(step < 0) return false; break;
+        case BinaryOp::Greater: adjust = 0; if(step > 0) return false; break;
+        case BinaryOp::GreaterEqual: adjust = -1; if(step > 0) return false; break;
+        default: return false;
     }
 
-    //Extract end value from condition like i < 3
-    size_t opPos = cond.find('<');
-    if(opPos == string::npos) opPos = cond.find('>');
-    if(opPos != string::npos) endExpr = trim(cond.substr(opPos+1));
-    else endExpr = "/*cond*/";
-
-    int step = 1;
-    if(inc.find("--") != string::npos) step = -1;
-
-    ostringstream ss;
-    ss << pad << "for " << var << " in range(" << start << ", " << endExpr;
-    if(step != 1) ss << ", " << step;
-    ss << "):\n";
-    for(auto &s:f.body) ss << toPython(*s,indentLevel+4) << "\n";
-    return ss.str();
+    indent(indentLevel,out);
+    out += "for ";
+    out += symbols[var];
+    out += options.fastPython ? " in __range(" : " in range(";
+    exprToPy(*start,out);
+    out += ", ";
+    long long end;
+    if(intLiteral(cond->right,symbols,end)) out += to_string(end + adjust);
+    else{
+        // (without its own parentheses, n or m + 1 would add to m alone)
+        bool group = adjust && options.fastPython && cond->right->pythonPrecedence() < binaryOpPythonPrecedence[(int)BinaryOp::Add];
+        if(group) out += '(';
+        exprToPy(*cond->right,out);
+        if(group) out += ')';
+        if(adjust) out += adjust > 0 ? " + 1" : " - 1";
+    }
+    if(step != 1){
+        out += ", ";
+        out += to_string(step);
+    }
+    out += "):\n";
+    return true;
 }
 
-
-// whileToPy  e.g. while (x>0){x=x-1;} => while (x>0):\n    x=(x-1)
-string CodeGenrator::whileToPy(const WhileStatementAST &w,int indentLevel){
-    ostringstream ss;
-    string pad = indent(indentLevel);
-    ss << pad << "while " << w.condition->toPython() << ":\n";
-    for(auto &s:w.body) ss << toPython(*s,indentLevel+4) << "\n";
-    return ss.str();
+// each statement of a body, one level deeper, followed by a newline
+// (an empty body, e.g. while (x) {} or one the optimizer emptied, gets a pass: Python needs a statement)
+void CodeGenrator::pushBody(const StatementList &body,int indentLevel){
+    if(body.empty()){
+        work.push_back({EmitItem::Pass,indentLevel + 4,nullptr,nullptr});
+        work.push_back({EmitItem::Newline,0,nullptr,nullptr});
+    }
+    for(auto &s:body){
+        work.push_back({EmitItem::Statement,indentLevel + 4,s,nullptr});
+        work.push_back({EmitItem::Newline,0,nullptr,nullptr});
+    }
 }
 
-// detect node type and call corresponding helper
-string CodeGenrator::toPython(const StatementAST &stmt,int indentLevel){
-    ostringstream out;
-    if(auto v = dynamic_cast<const VarDeclAST*>(&stmt)) out << indent(indentLevel) << varDeclToPy(*v);
-    else if(auto a = dynamic_cast<const AssignmentAST*>(&stmt)) out << indent(indentLevel) << assignToPy(*a);
-    else if(auto c = dynamic_cast<const CoutStatementAST*>(&stmt)) out << indent(indentLevel) << coutToPy(*c);
-    else if(auto i = dynamic_cast<const IfStatementAST*>(&stmt)) out << ifToPy(*i,indentLevel);
-    else if(auto f = dynamic_cast<const ForStatementAST*>(&stmt)) out << forToPy(*f,indentLevel);
-    else if(auto w = dynamic_cast<const WhileStatementAST*>(&stmt)) out << whileToPy(*w,indentLevel);
-    else out << indent(indentLevel) << "# unknown stmt\n";
-    return out.str();
+// toPython - walks nested statements with an explicit stack
+// e.g. if: emit "if cond:\n", then queue: then-body, "elif cond:\n" + its body
+// for each else-if, "else:\n" + else-body. Compound statements end with the
+// newline of their last body line, so the newline after them leaves a blank line.
+void CodeGenrator::toPython(const StatementAST &root,int rootIndent,string &out){
+    size_t base = work.size();
+    work.push_back({EmitItem::Statement,rootIndent,&root,nullptr});
+    while(work.size() > base){
+        EmitItem item = work.back();
+        work.pop_back();
+        size_t mark = work.size();
+        switch(item.kind){
+            case EmitItem::Newline: out += '\n'; continue;
+            case EmitItem::Elif:
+                if(item.condition){ // a broken arm has no header, just its marker
+                    indent(item.indentLevel,out);
+                    out += "elif ";
+                    exprToPy(*item.condition,out);
+                    out += ":\n";
+                }
+                continue;
+            case EmitItem::Else: indent(item.indentLevel,out); out += "else:\n"; continue;
+            case EmitItem::Pass: indent(item.indentLevel,out); out += "pass"; continue;
+            case EmitItem::Statement: break;
+        }
+        // one switch on the node's kind picks the handler
+        visitNode(*item.stmt,Overloaded{
+            [&](const VarDeclAST &v){ indent(item.indentLevel,out); varDeclToPy(v,out); },
+            [&](const AssignmentAST &a){ indent(item.indentLevel,out); assignToPy(a,out); },
+            [&](const CoutStatementAST &c){ indent(item.indentLevel,out); coutToPy(c,out); },
+            [&](const ErrorStatementAST &e){ // keeps the block non-empty
+                indent(item.indentLevel,out);
+                out += "pass  # ";
+                out += e.message;
+            },
+            [&](const IfStatementAST &i){
+                indent(item.indentLevel,out);
+                out += "if ";
+                exprToPy(*i.condition,out);
+                out += ":\n";
+                pushBody(i.thenBody,item.indentLevel);
+                for(auto &eif:i.elseIfBlocks){
+                    work.push_back({EmitItem::Elif,item.indentLevel,nullptr,eif.condition});
+                    pushBody(eif.body,item.indentLevel);
+                }
+                if(!i.elseBody.empty()){
+                    work.push_back({EmitItem::Else,item.indentLevel,nullptr,nullptr});
+                    pushBody(i.elseBody,item.indentLevel);
+                }
+            },
+            [&](const ForStatementAST &f){
+                if(forRangeToPy(f,item.indentLevel,out)){ pushBody(f.body,item.indentLevel); return; }
+                // init; while cond: body; step
+                if(auto v = nodeAs<VarDeclAST>(f.init)){ indent(item.indentLevel,out); varDeclToPy(*v,out); out += '\n'; }
+                else if(auto a = nodeAs<AssignmentAST>(f.init)){ indent(item.indentLevel,out); assignToPy(*a,out); out += '\n'; }
+                indent(item.indentLevel,out);
+                out += "while ";
+                if(f.condition) exprToPy(*f.condition,out);
+                else out += "True";
+                out += ":\n";
+                pushBody(f.body,item.indentLevel);
+                if(f.step){
+                    work.push_back({EmitItem::Statement,item.indentLevel + 4,f.step,nullptr});
+                    work.push_back({EmitItem::Newline,0,nullptr,nullptr});
+                }
+            },
+            [&](const WhileStatementAST &w){ // e.g. while (x>0){x=x-1;} => while (x>0):\n    x=(x-1)
+                indent(item.indentLevel,out);
+                out += "while ";
+                exprToPy(*w.condition,out);
+                out += ":\n";
+                pushBody(w.body,item.indentLevel);
+            },
+        });
+        reverse(work.begin() + mark,work.end()); // first child on top
+    }
 }
 
 // generate() - top-level driver
 string CodeGenrator::generate(const ProgramAST &program){
-    ostringstream out;
-    for(auto &stmt: program) out << toPython(*stmt,0) << "\n";
-    return out.str();
+    string out;
+    beginProgram(out);
+    for(auto &stmt: program) generateStatement(*stmt,out);
+    endProgram(out);
+    return out;
 }
 
-// main driver - read from file input.cpp and export output.py
-int main(){
-    ifstream inputFile("input.txt");
-    if(!inputFile.is_open()){
-        cerr << "Error: could not open input.txt" << endl;
-        return 1;
+void CodeGenrator::generate(const ProgramAST &program,ostream &sink){
+    ChunkedWriter writer(sink);
+    beginProgram(writer.buffer());
+    for(auto &stmt: program){
+        generateStatement(*stmt,writer.buffer());
+        writer.statementDone();
     }
+    endProgram(writer.buffer());
+}
+
+// fastPython: def main(): with the aliases first (names with a leading __ are reserved
+// in C++, so no translated variable can take them), and a call at the end
+void CodeGenrator::beginProgram(string &out){
+    if(options.fastPython) out += "def main():\n    __print = print\n    __range = range\n\n";
+}
 
-    stringstream buffer;
-    buffer << inputFile.rdbuf();
-    string input = buffer.str();
-    inputFile.close();
+void CodeGenrator::endProgram(string &out){
+    if(options.fastPython) out += "\nif __name__ == \"__main__\":\n    main()\n";
+}
+
+string CodeGenrator::generateStatement(const StatementAST &stmt){
+    string out;
+    generateStatement(stmt,out);
+    return out;
+}
+
+void CodeGenrator::generateStatement(const StatementAST &stmt,string &out){
+    toPython(stmt,options.fastPython ? 4 : 0,out); // fastPython: inside main()
+    out += '\n';
+}
 
-    Lexer lexer(input);
-    auto tokens = lexer.tokenize();
-    Parser parser(tokens);
-    auto program = parser.parse();
+#ifndef CODEGEN_NO_MAIN // bench.cpp brings its own main
+// main driver - read from file input.txt and export output.py
+// usage: ./codegen [--stream | --pipeline | --parallel N] [--optimize] [--fast] [--lex-threads N] [--max-depth N] [input] [output]
+//   --stream         mmap the input and lex/parse/emit one top-level statement at a time,
+//                    so memory stays proportional to the lookahead instead of the file size
+//   --pipeline       like --stream, but lexer, parser, codegen and writer each get a thread
+//   --parallel N     parse and emit runs of top-level statements on N threads (0 = one per core)
+//   --optimize       fold constant arithmetic and drop branches that can never run (optimize.cpp)
+//   --fast           emit Python that runs faster: locals in main(), aliased builtins, fewer parentheses
+//   --lex-threads N  lex the input in N chunks on N threads (ignored with --stream)
+//   --max-depth N    nesting limit for blocks and parenthesized/prefixed expressions (default 10000);
+//                    deeper input is reported as a parse error
+int main(int argc,char **argv){
+    bool streaming = false;
+    bool pipelined = false;
+    unsigned parallelThreads = 0;
+    bool parallel = false;
+    bool optimize = false;
+    CodegenOptions codegenOptions;
+    unsigned lexThreads = 1;
+    size_t maxDepth = 10000;
+    vector<string> paths;
+    for(int i = 1 ; i < argc ; ++i){
+        string arg = argv[i];
+        if(arg == "--stream") streaming = true;
+        else if(arg == "--pipeline") pipelined = true;
+        else if(arg == "--parallel" && i + 1 < argc){ parallel = true; parallelThreads = max(0,atoi(argv[++i])); }
+        else if(arg == "--optimize") optimize = true;
+        else if(arg == "--fast") codegenOptions.fastPython = true;
+        else if(arg == "--lex-threads" && i + 1 < argc) lexThreads = max(1,atoi(argv[++i]));
+        else if(arg == "--max-depth" && i + 1 < argc) maxDepth = max(1,atoi(argv[++i]));
+        else paths.push_back(arg);
+    }
+    string inputPath = paths.size() > 0 ? paths[0] : "input.txt";
+    string outputPath = paths.size() > 1 ? paths[1] : "output.py";
 
-    CodeGenrator gen;
-    string pythonCode = gen.generate(program);
+    SourceBuffer source;
+    bool opened = streaming || pipelined ? source.map(inputPath) : source.read(inputPath);
+    if(!opened){
+        cerr << "Error: could not open " << inputPath << endl;
+        return 1;
+    }
 
-    ofstream outFile("output.py");
+    ofstream outFile(outputPath);
     if(!outFile.is_open()){
-        cerr << "Error: could not create output.py" << endl;
+        cerr << "Error: could not create " << outputPath << endl;
         return 1;
     }
-    outFile << pythonCode;
+
+    Lexer lexer(source);
+    ParseContext ctx;
+    CodeGenrator gen(ctx.symbols,codegenOptions);
+    Optimizer optimizer(ctx.symbols);
+    vector<StatementAST*> optimized;
+    // parse errors don't stop the translation: the statements that parsed are
+    // still emitted, each bad region becomes a "pass  # Parser Error ..." line
+    vector<string> errors;
+    string prologue,epilogue; // around the statements when they are emitted one by one
+    gen.beginProgram(prologue);
+    gen.endProgram(epilogue);
+    if(pipelined){
+        PipelineOptions options;
+        options.maxDepth = maxDepth;
+        if(optimize) options.rewrite = [&](StatementAST *stmt,Arena &arena,vector<StatementAST*> &out){ optimizer.run(stmt,arena,out); };
+        outFile << prologue;
+        errors = runPipeline(lexer,ctx,outFile,[&](const StatementAST &stmt,string &out){ gen.generateStatement(stmt,out); },options);
+        outFile << epilogue;
+    }
+    else if(streaming){
+        Parser parser(lexer,ctx);
+        parser.setMaxDepth(maxDepth);
+        ChunkedWriter writer(outFile);
+        writer.buffer() += prologue;
+        while(auto stmt = parser.parseNext()){
+            optimized.assign(1,stmt);
+            if(optimize){
+                optimized.clear();
+                optimizer.run(stmt,ctx.arena,optimized);
+            }
+            for(auto *s : optimized) gen.generateStatement(*s,writer.buffer());
+            writer.statementDone();
+            ctx.arena.reset(); // that statement is emitted, reuse its memory
+        }
+        writer.buffer() += epilogue;
+        errors = parser.errors();
+    }
+    else if(parallel){
+        ParallelOptions options;
+        if(parallelThreads) options.threads = parallelThreads;
+        options.maxDepth = maxDepth;
+        auto emit = [optimize,codegenOptions](ProgramAST &program,ParseContext &local,string &out){
+            if(optimize) program = Optimizer(local.symbols).run(program,local.arena);
+            CodeGenrator gen(local.symbols,codegenOptions);
+            for(auto *stmt : program) gen.generateStatement(*stmt,out);
+        };
+        outFile << prologue;
+        errors = runParallel(lexer.tokenize(lexThreads),ctx,outFile,emit,options);
+        outFile << epilogue;
+    }
+    else{
+        auto tokens = lexer.tokenize(lexThreads);
+        Parser parser(move(tokens),ctx);
+        parser.setMaxDepth(maxDepth);
+        auto program = parser.parse();
+        if(optimize) program = optimizer.run(program,ctx.arena);
+        gen.generate(program,outFile);
+        errors = parser.errors();
+    }
     outFile.close();
 
-    cout << "Conversion successful! Generated output.py file.\n";
+    for(auto &e:errors) cerr << e << "\n";
+    if(!errors.empty()){
+        cerr << errors.size() << " error(s). Generated " << outputPath << " with the bad statements left out.\n";
+        return 1;
+    }
+    cout << "Conversion successful! Generated " << outputPath << " file.\n";
     return 0;
 }
+#endif
+#endif
@@ -0,0 +1,314 @@
+#ifndef FLATAST_CPP
+#define FLATAST_CPP
+#include <bits/stdc++.h>
+#include "parser.cpp"
+using namespace std;
+
+// Flat AST:
+// The same tree as the parser's node classes, laid out as one contiguous array
+// of 16-byte tagged nodes that refer to each other by 32-bit index. Child lists
+// (block bodies, cout parts, if arms) live in a side array of indices. Nodes are
+// stored parent first, siblings close together, so a walk over a large program
+// streams through memory instead of chasing pointers across the arena.
+//
+// There are no pointers inside: copying, serializing or handing a FlatAST to
+// another thread is copying four plain vectors. Names and literals are Symbols,
+// spelled by the SymbolTable the program was parsed with.
+
+constexpr uint32_t NoNode = UINT32_MAX; // a missing child, e.g. int x; has no value
+
+enum class NodeKind : uint8_t { Number , Variable , String , Binary , Unary , VarDecl , Assignment , Cout , If , Elif , Else , For , While , Error };
+
+// What a, b and c hold for each kind ("list" = an offset into FlatAST::lists):
+//   Number, Variable, String   a: symbol
+//   Binary                     op: BinaryOp, a: left, b: right
+//   Unary                      op: UnaryOp, a: operand
+//   VarDecl                    a: type symbol, b: name symbol, c: initial value or NoNode
+//   Assignment                 a: name symbol, b: value
+//   Cout                       op: 1 if it ends in endl, a: list of parts
+//   If                         a: condition, b: list of then statements, c: list of Elif / Else arms
+//   Elif                       a: condition (NoNode for an arm that failed to parse), b: list of statements
+//   Else                       b: list of statements
+//   For                        a: list of [init, condition, step] (each may be NoNode), b: list of statements
+//   While                      a: condition, b: list of statements
+//   Error                      a: offset of the message in FlatAST::text, b: its length
+struct FlatNode{
+    NodeKind kind;
+    uint8_t op = 0;
+    uint32_t a = NoNode, b = NoNode, c = NoNode;
+};
+static_assert(sizeof(FlatNode) == 16,"FlatNode should stay 16 bytes");
+
+struct FlatAST{
+    vector<FlatNode> nodes;
+    vector<uint32_t> lists;    // each list: its length, then that many node indices
+    string text;               // error messages
+    vector<uint32_t> roots;    // the top-level statements, in order
+
+    ArenaSpan<const uint32_t> list(uint32_t at) const{
+        ArenaSpan<const uint32_t> span;
+        span.items = lists.data() + at + 1;
+        span.count = lists[at];
+        return span;
+    }
+    string_view message(const FlatNode &n) const{ return string_view(text).substr(n.a,n.b); }
+};
+
+// Flattening:
+// Nodes are placed as they are reached, so a parent gets its index (and its
+// child lists their room) before any child exists; each child then writes its
+// index into the slot its parent left for it. The walk uses an explicit stack,
+// like the other walkers, so nesting depth is not bounded by the native stack.
+class Flattener{
+    FlatAST &flat;
+
+    // where a pending child's index goes: field a / b / c of a node, or an entry of lists
+    enum Field : uint8_t { A , B , C , ListEntry };
+    struct Pending{
+        const ExprAST *expr;
+        const StatementAST *stmt;
+        uint32_t at;    // node index, or offset into lists
+        Field field;
+    };
+    vector<Pending> work;
+
+    uint32_t &slot(const Pending &p){
+        if(p.field == ListEntry) return flat.lists[p.at];
+        FlatNode &n = flat.nodes[p.at];
+        return p.field == A ? n.a : p.field == B ? n.b : n.c;
+    }
+    uint32_t addNode(NodeKind kind,uint8_t op = 0){
+        flat.nodes.push_back({kind,op});
+        return (uint32_t)flat.nodes.size() - 1;
+    }
+    // room for count children; returns the list's offset, its entries start at offset + 1
+    uint32_t addList(size_t count){
+        uint32_t at = (uint32_t)flat.lists.size();
+        flat.lists.push_back((uint32_t)count);
+        flat.lists.resize(flat.lists.size() + count,NoNode);
+        return at;
+    }
+    void later(const ExprAST *e,uint32_t at,Field field){ if(e) work.push_back({e,nullptr,at,field}); }
+    void later(const StatementAST *s,uint32_t at,Field field){ if(s) work.push_back({nullptr,s,at,field}); }
+    template<class Items>
+    uint32_t laterList(const Items &items){
+        uint32_t at = addList(items.size());
+        for(uint32_t i = 0 ; i < items.size() ; ++i) later(items[i],at + 1 + i,ListEntry);
+        return at;
+    }
+
+    uint32_t leaf(NodeKind kind,Symbol sym){
+        uint32_t id = addNode(kind);
+        flat.nodes[id].a = sym.id;
+        return id;
+    }
+
+    uint32_t place(const ExprAST &expr){
+        return visitNode(expr,Overloaded{
+            [&](const NumberExprAST &n){ return leaf(NodeKind::Number,n.value); },
+            [&](const VariableExprAST &v){ return leaf(NodeKind::Variable,v.name); },
+            [&](const StringLiteralExprAST &s){ return leaf(NodeKind::String,s.value); },
+            [&](const BinaryExprAST &b){
+                uint32_t id = addNode(NodeKind::Binary,(uint8_t)b.op);
+                later(b.left,id,A);
+                later(b.right,id,B);
+                return id;
+            },
+            [&](const UnaryExprAST &u){
+                uint32_t id = addNode(NodeKind::Unary,(uint8_t)u.op);
+                later(u.operand,id,A);
+                return id;
+            },
+        });
+    }
+
+    uint32_t place(const StatementAST &stmt){
+        return visitNode(stmt,Overloaded{
+            [&](const VarDeclAST &v){
+                uint32_t id = addNode(NodeKind::VarDecl);
+                flat.nodes[id].a = v.varType.id;
+                flat.nodes[id].b = v.varName.id;
+                later(v.initialValue,id,C);
+                return id;
+            },
+            [&](const AssignmentAST &a){
+                uint32_t id = addNode(NodeKind::Assignment);
+                flat.nodes[id].a = a.varName.id;
+                later(a.value,id,B);
+                return id;
+            },
+            [&](const CoutStatementAST &c){
+                uint32_t id = addNode(NodeKind::Cout,c.hasEndl);
+                uint32_t parts = laterList(c.parts);
+                flat.nodes[id].a = parts;
+                return id;
+            },
+            [&](const IfStatementAST &i){
+                uint32_t id = addNode(NodeKind::If);
+                later(i.condition,id,A);
+                uint32_t then = laterList(i.thenBody);
+                uint32_t arms = addList(i.elseIfBlocks.size() + !i.elseBody.empty());
+                flat.nodes[id].b = then;
+                flat.nodes[id].c = arms;
+                uint32_t entry = arms + 1;
+                for(auto &eif : i.elseIfBlocks){
+                    uint32_t arm = addNode(NodeKind::Elif);
+                    later(eif.condition,arm,A);
+                    uint32_t body = laterList(eif.body);
+                    flat.nodes[arm].b = body;
+                    flat.lists[entry++] = arm;
+                }
+                if(!i.elseBody.empty()){
+                    uint32_t arm = addNode(NodeKind::Else);
+                    uint32_t body = laterList(i.elseBody);
+                    flat.nodes[arm].b = body;
+                    flat.lists[entry] = arm;
+                }
+                return id;
+            },
+            [&](const ForStatementAST &f){
+                uint32_t id = addNode(NodeKind::For);
+                uint32_t header = addList(3);
+                later(f.init,header + 1,ListEntry);
+                later(f.condition,header + 2,ListEntry);
+                later((const StatementAST*)f.step,header + 3,ListEntry);
+                uint32_t body = laterList(f.body);
+                flat.nodes[id].a = header;
+                flat.nodes[id].b = body;
+                return id;
+            },
+            [&](const WhileStatementAST &w){
+                uint32_t id = addNode(NodeKind::While);
+                later(w.condition,id,A);
+                uint32_t body = laterList(w.body);
+                flat.nodes[id].b = body;
+                return id;
+            },
+            [&](const ErrorStatementAST &e){
+                uint32_t id = addNode(NodeKind::Error);
+                flat.nodes[id].a = (uint32_t)flat.text.size();
+                flat.nodes[id].b = (uint32_t)e.message.size();
+                flat.text += e.message;
+                return id;
+            },
+        });
+    }
+public:
+    explicit Flattener(FlatAST &into):flat(into){}
+
+    // appends stmt and everything under it, returns its index
+    uint32_t add(const StatementAST &stmt){
+        uint32_t root = place(stmt);
+        // children are pushed first to last; reverse each batch so the first child is placed first
+        reverse(work.begin(),work.end());
+        while(!work.empty()){
+            Pending p = work.back();
+            work.pop_back();
+            size_t mark = work.size();
+            uint32_t id = p.expr ? place(*p.expr) : place(*p.stmt);
+            slot(p) = id;
+            reverse(work.begin() + mark,work.end());
+        }
+        return root;
+    }
+};
+
+FlatAST flatten(const ProgramAST &program){
+    FlatAST flat;
+    Flattener flattener(flat);
+    flat.roots.reserve(program.size());
+    for(auto *stmt : program) flat.roots.push_back(flattener.add(*stmt));
+    return flat;
+}
+
+// Dumps node `root` in the same format as print() on the node it came from
+void dumpFlat(const FlatAST &flat,uint32_t root,const SymbolTable &syms){
+    // pending output: a node index, or literal text
+    struct Item{
+        uint32_t node;
+        string_view text;
+    };
+    vector<Item> work = {{root,{}}};
+    auto push = [&](initializer_list<Item> items){ work.insert(work.end(),items); };
+    auto pushList = [&](uint32_t at,string_view separator = {}){
+        auto items = flat.list(at);
+        for(uint32_t i = 0 ; i < items.size() ; ++i){
+            if(i && !separator.empty()) push({{NoNode,separator}});
+            push({{items[i],{}}});
+        }
+    };
+    auto node = [](uint32_t id){ return Item{id,{}}; };
+    auto text = [](string_view t){ return Item{NoNode,t}; };
+    while(!work.empty()){
+        Item item = work.back();
+        work.pop_back();
+        if(item.node == NoNode){ cout << item.text; continue; }
+        const FlatNode &n = flat.nodes[item.node];
+        size_t mark = work.size();
+        switch(n.kind){
+            case NodeKind::Number: cout << "Number(" << syms[Symbol{n.a}] << ")"; break;
+            case NodeKind::Variable: cout << "Variable(" << syms[Symbol{n.a}] << ")"; break;
+            case NodeKind::String: cout << "String(\"" << syms[Symbol{n.a}] << "\")"; break;
+            case NodeKind::Binary: push({text("BinaryOp("),text(binaryOpText[n.op]),text(","),node(n.a),text(","),node(n.b),text(")")}); break;
+            case NodeKind::Unary: push({text("UnaryOp("),text(unaryOpText[n.op]),text(","),node(n.a),text(")")}); break;
+            case NodeKind::VarDecl:
+                cout << "VarDecl(Type: " << syms[Symbol{n.a}] << ",Name: " << syms[Symbol{n.b}];
+                if(n.c != NoNode) push({text(",Value: "),node(n.c)});
+                push({text(")\n")});
+                break;
+            case NodeKind::Assignment:
+                cout << "Assignment(Name: " << syms[Symbol{n.a}] << ",Value: ";
+                push({node(n.b),text(")\n")});
+                break;
+            case NodeKind::Cout:
+                push({text("CoutStatement(")});
+                pushList(n.a,",");
+                if(n.op){
+                    if(flat.lists[n.a]) push({text(",")});
+                    push({text("ENDL")});
+                }
+                push({text(")\n")});
+                break;
+            case NodeKind::If:
+                push({text("IfStatement(Condition: "),node(n.a),text(", Then: [")});
+                pushList(n.b);
+                push({text("]")});
+                pushList(n.c);
+                push({text(")\n")});
+                break;
+            case NodeKind::Elif:
+                if(n.a == NoNode){ pushList(n.b); break; }
+                push({text(" ElseIf("),node(n.a),text(", [")});
+                pushList(n.b);
+                push({text("])")});
+                break;
+            case NodeKind::Else:
+                push({text(" Else: [")});
+                pushList(n.b);
+                push({text("]")});
+                break;
+            case NodeKind::For:{
+                auto header = flat.list(n.a);
+                push({text("ForStatement(Init: ")});
+                if(header[0] != NoNode) push({node(header[0])});
+                push({text(", Cond: ")});
+                if(header[1] != NoNode) push({node(header[1])});
+                push({text(", Inc: ")});
+                if(header[2] != NoNode) push({node(header[2])});
+                push({text(", Body: [")});
+                pushList(n.b);
+                push({text("])\n")});
+                break;
+            }
+            case NodeKind::While:
+                push({text("WhileStatement(Cond: "),node(n.a),text(", Body: [")});
+                pushList(n.b);
+                push({text("])\n")});
+                break;
+            case NodeKind::Error: cout << "Error(" << flat.message(n) << ")\n"; break;
+        }
+        reverse(work.begin() + mark,work.end());
+    }
+}
+
+#endif
@@ -1,12 +1,14 @@
 #ifndef LEXER_CPP
 #define LEXER_CPP
 #include <bits/stdc++.h>
+#include "source.cpp"
+#include "scan.cpp"
 using namespace std;
 
 // Lexer Analysis
 
 // 1) Token Types:
-enum class TokenType{
+enum class TokenType : uint8_t{
     // Keywords
     KEYWORD_INT,
     KEYWORD_FLOAT,
@@ -28,7 +30,10 @@ enum class TokenType{
     DOUBLE_EQUALS,  // ==
     PLUS,           // +
     PLUS_PLUS,      // ++
+    PLUS_EQUALS,    // +=
     MINUS,          // -
+    MINUS_MINUS,    // --
+    MINUS_EQUALS,   // -=
     MULTIPLY,       // *
     DIVIDE,         // /
     MODULO,         // %
@@ -38,6 +43,8 @@ enum class TokenType{
     GREATER_THAN_EQUAL,// >=
     NOT_EQUAL,          // !=
     STREAM_OPERATOR,    // <<
+    AND_AND,            // &&
+    OR_OR,              // ||
 
     //PUNCTUATION
     OPEN_PAREN,    // (
@@ -71,7 +78,10 @@ string tokenTypeToString(TokenType type){
         case TokenType::DOUBLE_EQUALS: return "DOUBLE_EQUALS";
         case TokenType::PLUS: return "PLUS";
         case TokenType::PLUS_PLUS: return "PLUS_PLUS";
+        case TokenType::PLUS_EQUALS: return "PLUS_EQUALS";
         case TokenType::MINUS: return "MINUS";
+        case TokenType::MINUS_MINUS: return "MINUS_MINUS";
+        case TokenType::MINUS_EQUALS: return "MINUS_EQUALS";
         case TokenType::MULTIPLY: return "MULTIPLY";
         case TokenType::DIVIDE: return "DIVIDE";
         case TokenType::MODULO: return "MODULO";
@@ -81,6 +91,8 @@ string tokenTypeToString(TokenType type){
         case TokenType::GREATER_THAN_EQUAL: return "GREATER_THAN_EQUAL";
         case TokenType::NOT_EQUAL: return "NOT_EQUAL";
         case TokenType::STREAM_OPERATOR: return "STREAM_OPERATOR";
+        case TokenType::AND_AND: return "AND_AND";
+        case TokenType::OR_OR: return "OR_OR";
         case TokenType::OPEN_PAREN: return "OPEN_PAREN";
         case TokenType::CLOSE_PAREN: return "CLOSE_PAREN";
         case TokenType::OPEN_BRACE: return "OPEN_BRACE";
@@ -92,20 +104,178 @@ string tokenTypeToString(TokenType type){
     }
 }
 
+// 3) Lookup Tables (built at compile time):
+
+// Character classes. Replaces isalpha/isdigit/isspace, which are locale-sensitive
+// and undefined for negative chars.
+enum CharClass : uint8_t{
+    CC_SPACE = 1,
+    CC_ALPHA = 2,   // letters and '_' (can start an identifier)
+    CC_DIGIT = 4,
+};
+
+constexpr array<uint8_t,256> makeCharClassTable(){
+    array<uint8_t,256> table{};
+    for(int c = 'a'; c <= 'z'; ++c) table[c] = CC_ALPHA;
+    for(int c = 'A'; c <= 'Z'; ++c) table[c] = CC_ALPHA;
+    table['_'] = CC_ALPHA;
+    for(int c = '0'; c <= '9'; ++c) table[c] = CC_DIGIT;
+    for(char c : {' ','\t','\n','\v','\f','\r'}) table[(unsigned char)c] = CC_SPACE;
+    return table;
+}
+constexpr array<uint8_t,256> charClass = makeCharClassTable();
+
+inline uint8_t classOf(char c){ return charClass[(unsigned char)c]; }
+
+// Keywords: perfect hash on (first char, last char, length) into 16 slots.
+struct KeywordSlot{
+    string_view text;
+    TokenType type = TokenType::IDENTIFIER;
+};
+
+constexpr KeywordSlot keywordList[] = {
+    {"int",TokenType::KEYWORD_INT},   {"float",TokenType::KEYWORD_FLOAT}, {"if",TokenType::KEYWORD_IF},
+    {"else",TokenType::KEYWORD_ELSE}, {"for",TokenType::KEYWORD_FOR},     {"while",TokenType::KEYWORD_WHILE},
+    {"cout",TokenType::KEYWORD_COUT}, {"main",TokenType::KEYWORD_MAIN},   {"endl",TokenType::KEYWORD_ENDL},
+};
+
+constexpr size_t keywordHash(string_view s){
+    return ((unsigned char)s.front() + (unsigned char)s.back() + 8*s.size()) & 15;
+}
+
+constexpr array<KeywordSlot,16> makeKeywordTable(){
+    array<KeywordSlot,16> table{};
+    for(const KeywordSlot &kw : keywordList) table[keywordHash(kw.text)] = kw;
+    return table;
+}
+constexpr array<KeywordSlot,16> keywordTable = makeKeywordTable();
+
+constexpr bool keywordHashIsPerfect(){
+    for(const KeywordSlot &kw : keywordList)
+        if(keywordTable[keywordHash(kw.text)].text != kw.text) return false;
+    return true;
+}
+static_assert(keywordHashIsPerfect(),"keyword hash has a collision, pick new constants");
+
+inline TokenType lookupKeyword(string_view word){ // word is never empty
+    const KeywordSlot &slot = keywordTable[keywordHash(word)];
+    return slot.text == word ? slot.type : TokenType::IDENTIFIER;
+}
+
+// Operators: for each first char, the one-char token and up to two second chars
+// that extend it into a two-char operator (e.g. '<' -> '<<', '<=').
+struct OperatorEntry{
+    TokenType single = TokenType::UNKNOWN;
+    char next[2] = {'\0','\0'};
+    TokenType pair[2] = {TokenType::UNKNOWN,TokenType::UNKNOWN};
+};
+
+constexpr array<OperatorEntry,256> makeOperatorTable(){
+    array<OperatorEntry,256> table{};
+    auto single = [&](char c,TokenType t){ table[(unsigned char)c].single = t; };
+    auto pair = [&](char c,int slot,char second,TokenType t){
+        table[(unsigned char)c].next[slot] = second;
+        table[(unsigned char)c].pair[slot] = t;
+    };
+    single('=',TokenType::EQUALS);       pair('=',0,'=',TokenType::DOUBLE_EQUALS);
+    single('+',TokenType::PLUS);         pair('+',0,'+',TokenType::PLUS_PLUS);
+                                         pair('+',1,'=',TokenType::PLUS_EQUALS);
+    single('<',TokenType::LESS_THAN);    pair('<',0,'<',TokenType::STREAM_OPERATOR);
+                                         pair('<',1,'=',TokenType::LESS_THAN_EQUAL);
+    single('>',TokenType::GREATER_THAN); pair('>',0,'=',TokenType::GREATER_THAN_EQUAL);
+                                         pair('!',0,'=',TokenType::NOT_EQUAL); // lone '!' stays UNKNOWN
+                                         pair('&',0,'&',TokenType::AND_AND);   // so do lone '&' and '|'
+                                         pair('|',0,'|',TokenType::OR_OR);
+    single('-',TokenType::MINUS);        pair('-',0,'-',TokenType::MINUS_MINUS);
+                                         pair('-',1,'=',TokenType::MINUS_EQUALS);
+    single('*',TokenType::MULTIPLY);
+    single('/',TokenType::DIVIDE);
+    single('%',TokenType::MODULO);
+    single('(',TokenType::OPEN_PAREN);
+    single(')',TokenType::CLOSE_PAREN);
+    single('{',TokenType::OPEN_BRACE);
+    single('}',TokenType::CLOSE_BRACE);
+    single(';',TokenType::SEMICOLON);
+    return table;
+}
+constexpr array<OperatorEntry,256> operatorTable = makeOperatorTable();
+
 //Token Structure:
+// value is a view into the Lexer's source buffer (no copy), so the Lexer must outlive its tokens
 struct Token{
     TokenType type;
-    string value;
+    string_view value;
     
-    Token(TokenType t,string v): type(t),value(v){}
+    Token(TokenType t,string_view v): type(t),value(v){}
+};
+
+// Token Stream (struct-of-arrays):
+// What the Parser walks. Types sit in their own dense byte array so the parser's
+// "current() == ..." checks stay in cache; the text is an offset/length into the
+// source and is only looked at when an AST leaf needs it.
+// 9 bytes per token, against 24 for a Token (and 40 + heap for the old std::string one).
+struct TokenStream{
+    string_view source;
+    vector<TokenType> types;
+    vector<uint32_t> offsets;
+    vector<uint32_t> lengths;
+
+    size_t size() const{ return types.size(); }
+
+    void push(const Token &tok){ // tok.value must point into source
+        types.push_back(tok.type);
+        offsets.push_back((uint32_t)(tok.value.data() - source.data()));
+        lengths.push_back((uint32_t)tok.value.size());
+    }
+
+    void append(const TokenStream &other){ // other must share our source
+        types.insert(types.end(),other.types.begin(),other.types.end());
+        offsets.insert(offsets.end(),other.offsets.begin(),other.offsets.end());
+        lengths.insert(lengths.end(),other.lengths.begin(),other.lengths.end());
+    }
+
+    void dropFront(size_t n){ // streaming: forget tokens the parser has moved past
+        types.erase(types.begin(),types.begin() + n);
+        offsets.erase(offsets.begin(),offsets.begin() + n);
+        lengths.erase(lengths.begin(),lengths.begin() + n);
+    }
+
+    // tokens [from,to) as a stream of their own, ending in END_OF_FILE like every stream
+    TokenStream slice(size_t from,size_t to) const{
+        TokenStream part;
+        part.source = source;
+        part.types.assign(types.begin() + from,types.begin() + to);
+        part.offsets.assign(offsets.begin() + from,offsets.begin() + to);
+        part.lengths.assign(lengths.begin() + from,lengths.begin() + to);
+        if(part.types.empty() || part.types.back() != TokenType::END_OF_FILE){
+            part.types.push_back(TokenType::END_OF_FILE);
+            part.offsets.push_back(to < size() ? offsets[to] : (uint32_t)source.size());
+            part.lengths.push_back(0);
+        }
+        return part;
+    }
+
+    string_view text(size_t i) const{ return source.substr(offsets[i],lengths[i]); }
+    Token at(size_t i) const{ return Token(types[i],text(i)); }
 };
 
 //Lexer Class:
 class Lexer{
 private:
-    string sourceCode;
-    int currentPos;
-    map<string,TokenType> keywords;
+    string ownedSource;     // only used when the Lexer is built from a string
+    string_view sourceCode;
+    size_t currentPos;
+    const ScanKernels *scan = &activeKernels(); // SIMD (or scalar) byte scanning
+
+    string_view slice(size_t start,size_t len) const{         // view into sourceCode
+        return string_view(sourceCode.data() + start,len);
+    }
+
+    Token makeToken(TokenType type,size_t len){            // token for the next len chars
+        Token tok(type,slice(currentPos,len));
+        currentPos += len;
+        return tok;
+    }
 
     char peek(){                                        // look next char
         if(currentPos + 1 >= sourceCode.length()){
@@ -116,71 +286,64 @@ private:
 
     void skipComment(){ 
         //single line comment
-        while(currentPos < sourceCode.length() && sourceCode[currentPos] != '\n'){
-            currentPos++;
-        }
+        currentPos += scan->findByte(sourceCode.data() + currentPos,sourceCode.length() - currentPos,'\n');
     }
 
     Token readIdentifier(){
-        string value;
-        while(currentPos < sourceCode.length() && (isalnum(sourceCode[currentPos]) || sourceCode[currentPos] == '_')){
-            value += sourceCode[currentPos];
+        size_t start = currentPos;
+        while(currentPos < sourceCode.length() && (classOf(sourceCode[currentPos]) & (CC_ALPHA | CC_DIGIT))){
             currentPos++;
         }
+        string_view value = slice(start,currentPos - start);
 
-        if(keywords.count(value)) return Token(keywords[value],value);
-        return Token(TokenType::IDENTIFIER,value);
+        return Token(lookupKeyword(value),value);
     }
 
     Token readNumber(){
-        string value;
+        size_t start = currentPos;
         bool hasDecimal = false;
-        while(currentPos < sourceCode.length() && (isdigit(sourceCode[currentPos]) || sourceCode[currentPos] =='.')){
+        while(currentPos < sourceCode.length() && ((classOf(sourceCode[currentPos]) & CC_DIGIT) || sourceCode[currentPos] =='.')){
             if(sourceCode[currentPos] == '.'){
                 if(hasDecimal) break; // only one decimal point allowed
                 hasDecimal = true;
             }
-            value += sourceCode[currentPos];
             currentPos++;
         }
-        return Token(TokenType::NUMBER_LITERAL,value);
+        return Token(TokenType::NUMBER_LITERAL,slice(start,currentPos - start));
     }
 
     Token readStringLiteral(){
-            string value;
             currentPos++; // skip opening quote
-            while(currentPos < sourceCode.length() && sourceCode[currentPos]!='"'){
-                value += sourceCode[currentPos];
-                currentPos++;
-            }
+            size_t start = currentPos;
+            currentPos += scan->findByte(sourceCode.data() + currentPos,sourceCode.length() - currentPos,'"');
+            string_view value = slice(start,currentPos - start);
             currentPos++;
             return Token(TokenType::STRING_LITERAL,value);
     }
 public:
-    Lexer(const string& source): sourceCode(source),currentPos(0){
-
-        keywords["int"] = TokenType::KEYWORD_INT;
-        keywords["float"] = TokenType::KEYWORD_FLOAT;
-        keywords["if"] = TokenType::KEYWORD_IF;
-        keywords["else"] = TokenType::KEYWORD_ELSE;
-        keywords["for"] = TokenType::KEYWORD_FOR;
-        keywords["while"] = TokenType::KEYWORD_WHILE;
-        keywords["cout"] = TokenType::KEYWORD_COUT;
-        keywords["main"] = TokenType::KEYWORD_MAIN;
-        keywords["endl"] = TokenType::KEYWORD_ENDL;
-    }
+    Lexer(const string& source): ownedSource(source),sourceCode(ownedSource),currentPos(0){}
 
-    // function to have list of tockens:
+    // borrows the buffer (e.g. an mmap'd file) instead of copying it
+    Lexer(const SourceBuffer& source): sourceCode(source.view()),currentPos(0){}
+
+    // tokens point into sourceCode, so a Lexer can't be copied or moved out from under them
+    Lexer(const Lexer&) = delete;
+    Lexer& operator=(const Lexer&) = delete;
 
-    vector<Token>tokenize(){
-        vector<Token>tokens;
+    void setScanKernels(const ScanKernels &kernels){ scan = &kernels; } // e.g. force scalar for benchmarking
 
+    // Pull API: lex and return the next token, END_OF_FILE once the input is exhausted
+    Token nextToken(){
         while(currentPos < sourceCode.length()){
             char currentChar = sourceCode[currentPos];
+            uint8_t cls = classOf(currentChar);
 
             // 1. skip Whitespace
-            if(isspace(currentChar)){
+            if(cls & CC_SPACE){
                 currentPos++;
+                // most gaps are a single space, only call into the kernel for longer runs
+                if(currentPos < sourceCode.length() && isSpaceByte(sourceCode[currentPos]))
+                    currentPos += scan->skipSpaces(sourceCode.data() + currentPos,sourceCode.length() - currentPos);
                 continue;
             }
             
@@ -191,104 +354,124 @@ public:
             }
 
             // 3. Identifiers and Keywords
-            if(isalpha(currentChar) || currentChar == '_'){
-                tokens.push_back(readIdentifier());
-                continue;
+            if(cls & CC_ALPHA){
+                return readIdentifier();
             }
             // 4. Numbers
-            if(isdigit(currentChar)){
-                tokens.push_back(readNumber());
-                continue;
+            if(cls & CC_DIGIT){
+                return readNumber();
             }
             // 5. String Literals
             if(currentChar == '"'){
-                tokens.push_back(readStringLiteral());
-                continue;
+                return readStringLiteral();
             }
-            // 6. Operators and Punctuation
-             if (currentChar == '=') {
-                if (peek() == '=') {
-                    tokens.push_back(Token(TokenType::DOUBLE_EQUALS, "=="));
-                    currentPos += 2;
-                } else {
-                    tokens.push_back(Token(TokenType::EQUALS, "="));
-                    currentPos++;
-                }
-            } else if (currentChar == '+') {
-                if (peek() == '+') {
-                    tokens.push_back(Token(TokenType::PLUS_PLUS, "++"));
-                    currentPos += 2;
-                } else {
-                    tokens.push_back(Token(TokenType::PLUS, "+"));
-                    currentPos++;
-                }
-            } else if (currentChar == '<') {
-                if (peek() == '<') {
-                    tokens.push_back(Token(TokenType::STREAM_OPERATOR, "<<"));
-                    currentPos += 2;
-                } else if (peek() == '=') {
-                    tokens.push_back(Token(TokenType::LESS_THAN_EQUAL, "<="));
-                    currentPos += 2;
-                } else {
-                    tokens.push_back(Token(TokenType::LESS_THAN, "<"));
-                    currentPos++;
-                }
-            } else if (currentChar == '>') {
-                if (peek() == '=') {
-                    tokens.push_back(Token(TokenType::GREATER_THAN_EQUAL, ">="));
-                    currentPos += 2;
-                } else {
-                    tokens.push_back(Token(TokenType::GREATER_THAN, ">"));
-                    currentPos++;
-                }
-            } else if (currentChar == '!') {
-                 if (peek() == '=') {
-                    tokens.push_back(Token(TokenType::NOT_EQUAL, "!="));
-                    currentPos += 2;
-                } else {
-                    tokens.push_back(Token(TokenType::UNKNOWN, "!"));
-                    currentPos++;
-                }
-            } else if (currentChar == '-') {
-                tokens.push_back(Token(TokenType::MINUS, "-"));
-                currentPos++;
-            } else if (currentChar == '*') {
-                tokens.push_back(Token(TokenType::MULTIPLY, "*"));
-                currentPos++;
-            } else if (currentChar == '/') {
-                tokens.push_back(Token(TokenType::DIVIDE, "/"));
-                currentPos++;
-            } else if (currentChar == '%') { 
-                tokens.push_back(Token(TokenType::MODULO, "%"));
-                currentPos++;
-            } else if (currentChar == '(') {
-                tokens.push_back(Token(TokenType::OPEN_PAREN, "("));
-                currentPos++;
-            } else if (currentChar == ')') {
-                tokens.push_back(Token(TokenType::CLOSE_PAREN, ")"));
-                currentPos++;
-            } else if (currentChar == '{') {
-                tokens.push_back(Token(TokenType::OPEN_BRACE, "{"));
-                currentPos++;
-            } else if (currentChar == '}') {
-                tokens.push_back(Token(TokenType::CLOSE_BRACE, "}"));
-                currentPos++;
-            } else if (currentChar == ';') {
-                tokens.push_back(Token(TokenType::SEMICOLON, ";"));
-                currentPos++;
-            } else {
-                // If we don't recognize the character, it's an UNKNOWN token.
-                tokens.push_back(Token(TokenType::UNKNOWN, string(1, currentChar)));
-                currentPos++;
+            // 6. Operators and Punctuation, straight from the transition table.
+            // Characters we don't recognize come out as a one-char UNKNOWN token.
+            const OperatorEntry &op = operatorTable[(unsigned char)currentChar];
+            char following = peek();
+            for(int k = 0 ; k < 2 ; ++k){
+                if(op.next[k] != '\0' && op.next[k] == following) return makeToken(op.pair[k], 2);
             }
+            return makeToken(op.single, 1);
+        }
+
+        return Token(TokenType::END_OF_FILE, slice(sourceCode.length(),0));
+    }
+
+    // look at the next token without consuming it
+    Token peekToken(){
+        size_t saved = currentPos;
+        Token tok = nextToken();
+        currentPos = saved;
+        return tok;
+    }
+
+    string_view source() const{ return sourceCode; }
+
+    // function to have list of tockens:
+
+    TokenStream tokenize(){
+        TokenStream tokens = emptyStream();
+        lexInto(tokens);
+        tokens.push(Token(TokenType::END_OF_FILE, slice(sourceCode.length(),0))); // the Parser relies on this EOF token
+        return tokens;
+    }
+
+    // Parallel mode: cut the source at safe newlines, lex each chunk on its own
+    // thread and concatenate in order. Produces exactly the tokens tokenize() does.
+    TokenStream tokenize(unsigned threads){
+        const size_t minChunkBytes = 1 << 16; // below this, thread startup costs more than it saves
+        threads = (unsigned)min<size_t>(threads,(sourceCode.length() - currentPos) / minChunkBytes);
+        if(threads <= 1) return tokenize();
+
+        vector<size_t> cuts = chunkBoundaries(threads);
+        vector<TokenStream> parts(cuts.size() - 1,emptyStream());
+        vector<thread> workers;
+        for(size_t i = 0 ; i < parts.size() ; ++i){
+            workers.emplace_back([this,&cuts,&parts,i]{
+                Lexer chunk(sourceCode.substr(cuts[i],cuts[i+1] - cuts[i]),*scan);
+                chunk.lexInto(parts[i]);
+            });
         }
+        for(auto &w : workers) w.join();
+        currentPos = sourceCode.length();
 
-        // Add one final End-Of-File token so the Parser knows we're done.
-        tokens.push_back(Token(TokenType::END_OF_FILE, ""));
+        TokenStream tokens = emptyStream();
+        for(auto &part : parts) tokens.append(part);
+        tokens.push(Token(TokenType::END_OF_FILE, slice(sourceCode.length(),0)));
         return tokens;
     }
 
+private:
+    // lexes a chunk of a larger buffer; its tokens still point into that buffer
+    Lexer(string_view chunk,const ScanKernels &kernels): sourceCode(chunk),currentPos(0),scan(&kernels){}
+
+    TokenStream emptyStream() const{
+        // offsets are 32-bit to keep the stream compact
+        if(sourceCode.length() > UINT32_MAX) throw runtime_error("Lexer Error: input larger than 4 GB");
+        TokenStream tokens;
+        tokens.source = sourceCode;
+        return tokens;
+    }
 
+    void lexInto(TokenStream &tokens){ // everything up to (not including) END_OF_FILE
+        for(;;){
+            Token tok = nextToken();
+            if(tok.type == TokenType::END_OF_FILE) break;
+            tokens.push(tok);
+        }
+    }
+
+    // Offsets where a fresh Lexer sees exactly what the serial one would: just past a
+    // newline that isn't inside a "..." literal. A // comment always ends at its newline,
+    // but "//" inside a literal or a '"' inside a comment must not fool us, so we walk
+    // literals and comments from the start, jumping between interesting bytes.
+    vector<size_t> chunkBoundaries(unsigned chunks){
+        const char *p = sourceCode.data();
+        size_t n = sourceCode.length();
+        vector<size_t> cuts = {currentPos};
+        size_t pos = currentPos; // always outside literals and comments
+        for(unsigned k = 1 ; k < chunks && pos < n ; ++k){
+            size_t target = max(pos,currentPos + (n - currentPos) / chunks * k);
+            for(;;){
+                // before the target only literals and comments matter, after it the first newline wins
+                char newline = pos < target ? '"' : '\n';
+                size_t hit = pos + scan->findAnyOf(p + pos,n - pos,'"','/',newline);
+                if(hit >= n){ pos = n; break; }
+                if(p[hit] == '\n'){ pos = hit + 1; break; }
+                if(p[hit] == '"'){
+                    pos = hit + 1;
+                    pos += scan->findByte(p + pos,n - pos,'"') + 1;
+                }
+                else if(hit + 1 < n && p[hit+1] == '/') pos = hit + scan->findByte(p + hit,n - hit,'\n');
+                else pos = hit + 1;
+                if(pos >= n){ pos = n; break; }
+            }
+            if(pos > cuts.back() && pos < n) cuts.push_back(pos);
+        }
+        cuts.push_back(n);
+        return cuts;
+    }
 };
 // int main() {
 //     // Sample source code for tokenization
@@ -310,11 +493,11 @@ public:
 //     Lexer lexer(sourceCode);
 
 //     // Tokenize the source code
-//     vector<Token> tokens = lexer.tokenize();
+//     TokenStream tokens = lexer.tokenize();
 
 //     // Print out each token and its type
-//     for (const auto& token : tokens) {
-//         cout << "Token: " << token.value << ", Type: " << tokenTypeToString(token.type) << endl;
+//     for (size_t i = 0; i < tokens.size(); ++i) {
+//         cout << "Token: " << tokens.text(i) << ", Type: " << tokenTypeToString(tokens.types[i]) << endl;
 //     }
 
 //     return 0;
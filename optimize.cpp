@@ -0,0 +1,334 @@
+#ifndef OPTIMIZE_CPP
+#define OPTIMIZE_CPP
+#include <bits/stdc++.h>
+#include "parser.cpp"
+using namespace std;
+
+// AST Optimizer:
+// An optional pass between the parser and codegen (./codegen --optimize).
+//  - Constant folding: arithmetic on literals is done now, by C++ rules: int with
+//    int stays int (/ truncates, % keeps the dividend's sign), anything with a
+//    float is double. A declaration converts a folded value to its declared type,
+//    so int x = 2.5 * 3; is x = 7 and float f = 7 / 2; is f = 3.0.
+//    Comparisons, && and || are only decided for branches; inside a value they
+//    stay as written (Python would print True where C++ prints 1).
+//  - Dead branches: an if / else-if arm whose condition is constant false is
+//    dropped, a constant true one becomes the else and ends the chain. An if
+//    with a single arm left that always runs is replaced by that arm's body.
+//    A while or for loop whose condition starts out false is dropped (a for
+//    keeps its init).
+// Expressions can't have side effects in this subset, so x && 0 counts as false.
+// Nothing is folded that would overflow int, divide by zero or not be finite:
+// that is left to Python at run time.
+//
+// Like the other passes it walks with explicit stacks, never the native one.
+
+// value of a constant expression
+struct ConstValue{
+    bool isFloat = false;
+    long long i = 0;
+    double f = 0;
+
+    double asDouble() const{ return isFloat ? f : (double)i; }
+    bool truthy() const{ return isFloat ? f != 0 : i != 0; }
+};
+
+class Optimizer{
+    SymbolTable &symbols;
+    Arena *arena = nullptr;
+
+    // expression folding: a post-order walk over slots (the pointers that hold each child)
+    struct FoldFrame{
+        ExprAST **slot;
+        bool childrenDone;
+    };
+    vector<FoldFrame> frames;
+    vector<optional<ConstValue>> values; // one per finished subexpression
+
+    vector<StatementAST*> pending;  // statements still to rewrite into the current block, last one first
+    vector<StatementList*> bodies;  // blocks still to optimize
+    vector<StatementAST*> scratch;  // a block's new statements, copied out when it's done
+    vector<ElseIfBlock> arms;
+
+    static bool fitsInt(long long v){ return v >= INT_MIN && v <= INT_MAX; }
+
+    bool literalValue(const NumberExprAST &n,ConstValue &v){
+        string text(symbols[n.value]);
+        if(text.find('.') != string::npos){
+            v.isFloat = true;
+            v.f = strtod(text.c_str(),nullptr);
+            return isfinite(v.f);
+        }
+        if(text.empty() || text.size() > 10) return false;
+        v.i = stoll(text);
+        return fitsInt(v.i); // bigger literals are long in C++: leave them alone
+    }
+
+    // op applied to a and b, or nullopt when C++ would not give a plain int / double
+    static optional<ConstValue> evaluate(BinaryOp op,const ConstValue &a,const ConstValue &b){
+        ConstValue r;
+        bool useFloat = a.isFloat || b.isFloat;
+        switch(op){
+            case BinaryOp::Add: case BinaryOp::Sub: case BinaryOp::Mul: case BinaryOp::Div: case BinaryOp::Mod:
+                if(useFloat){
+                    if(op == BinaryOp::Mod) return nullopt; // not C++
+                    double x = a.asDouble(),y = b.asDouble();
+                    r.isFloat = true;
+                    r.f = op == BinaryOp::Add ? x + y : op == BinaryOp::Sub ? x - y : op == BinaryOp::Mul ? x * y : x / y;
+                    if(!isfinite(r.f)) return nullopt;
+                    return r;
+                }
+                if((op == BinaryOp::Div || op == BinaryOp::Mod) && b.i == 0) return nullopt;
+                r.i = op == BinaryOp::Add ? a.i + b.i : op == BinaryOp::Sub ? a.i - b.i : op == BinaryOp::Mul ? a.i * b.i
+                    : op == BinaryOp::Div ? a.i / b.i : a.i % b.i; // both truncate toward zero, like C++
+                if(!fitsInt(r.i)) return nullopt;
+                return r;
+            case BinaryOp::Equal: r.i = a.asDouble() == b.asDouble(); break;
+            case BinaryOp::NotEqual: r.i = a.asDouble() != b.asDouble(); break;
+            case BinaryOp::Less: r.i = useFloat ? a.asDouble() < b.asDouble() : a.i < b.i; break;
+            case BinaryOp::LessEqual: r.i = useFloat ? a.asDouble() <= b.asDouble() : a.i <= b.i; break;
+            case BinaryOp::Greater: r.i = useFloat ? a.asDouble() > b.asDouble() : a.i > b.i; break;
+            case BinaryOp::GreaterEqual: r.i = useFloat ? a.asDouble() >= b.asDouble() : a.i >= b.i; break;
+            case BinaryOp::And: r.i = a.truthy() && b.truthy(); break;
+            case BinaryOp::Or: r.i = a.truthy() || b.truthy(); break;
+        }
+        return r;
+    }
+
+    static bool isArithmetic(BinaryOp op){
+        return op == BinaryOp::Add || op == BinaryOp::Sub || op == BinaryOp::Mul || op == BinaryOp::Div || op == BinaryOp::Mod;
+    }
+
+    // a literal for v: 5, 2.5, or -5 as UnaryOp(-, 5) like the parser builds it
+    ExprAST *makeLiteral(const ConstValue &v){
+        bool negative = v.isFloat ? signbit(v.f) : v.i < 0;
+        string text;
+        if(!v.isFloat) text = to_string(negative ? -v.i : v.i);
+        else{
+            double magnitude = fabs(v.f);
+            char buf[32];
+            for(int precision = 15 ; precision <= 17 ; ++precision){ // shortest text that reads back as the same double
+                snprintf(buf,sizeof buf,"%.*g",precision,magnitude);
+                if(strtod(buf,nullptr) == magnitude) break;
+            }
+            text = buf;
+            if(text.find_first_of(".e") == string::npos) text += ".0"; // keep it a float in Python
+        }
+        ExprAST *literal = arena->make<NumberExprAST>(symbols.intern(text));
+        return negative ? arena->make<UnaryExprAST>(UnaryOp::Negate,literal) : literal;
+    }
+
+    // folds the expression in *root in place; returns its value if it is a constant
+    // (comparisons and logic included, though only arithmetic is replaced by a literal)
+    optional<ConstValue> fold(ExprAST *&root){
+        frames.push_back({&root,false});
+        size_t valueBase = values.size();
+        while(!frames.empty()){
+            FoldFrame frame = frames.back();
+            frames.pop_back();
+            ExprAST *e = *frame.slot;
+            if(auto node = nodeAs<BinaryExprAST>(e)){
+                if(!frame.childrenDone){
+                    frames.push_back({frame.slot,true});
+                    frames.push_back({&node->right,false});
+                    frames.push_back({&node->left,false});
+                    continue;
+                }
+                optional<ConstValue> right = values.back(); values.pop_back();
+                optional<ConstValue> left = values.back(); values.pop_back();
+                optional<ConstValue> result;
+                if(left && right) result = evaluate(node->op,*left,*right);
+                else if(node->op == BinaryOp::And && ((left && !left->truthy()) || (right && !right->truthy()))) result = ConstValue{};
+                else if(node->op == BinaryOp::Or && ((left && left->truthy()) || (right && right->truthy()))){ result = ConstValue{}; result->i = 1; }
+                if(result && isArithmetic(node->op)) *frame.slot = makeLiteral(*result);
+                values.push_back(result);
+            }
+            else if(auto node = nodeAs<UnaryExprAST>(e)){
+                if(!frame.childrenDone){
+                    frames.push_back({frame.slot,true});
+                    frames.push_back({&node->operand,false});
+                    continue;
+                }
+                optional<ConstValue> result = values.back(); values.pop_back();
+                if(result){
+                    if(result->isFloat) result->f = -result->f;
+                    else if(fitsInt(-result->i)) result->i = -result->i;
+                    else result = nullopt;
+                }
+                // -5 is already as folded as it gets; -(2 + 3) and --5 become literals
+                if(result && !nodeAs<NumberExprAST>(node->operand)) *frame.slot = makeLiteral(*result);
+                values.push_back(result);
+            }
+            else if(auto n = nodeAs<NumberExprAST>(e)){
+                ConstValue v;
+                values.push_back(literalValue(*n,v) ? optional<ConstValue>(v) : nullopt);
+            }
+            else values.push_back(nullopt); // variables and strings
+        }
+        optional<ConstValue> result = values.back();
+        values.resize(valueBase);
+        return result;
+    }
+
+    // int x = 2.5 * 3; => x = 7 ; float f = 7 / 2; => f = 3.0
+    void foldDeclaration(VarDeclAST &v){
+        if(!v.initialValue) return;
+        optional<ConstValue> value = fold(v.initialValue);
+        if(!value) return;
+        string_view type = symbols[v.varType];
+        if(type == "int" && value->isFloat){
+            if(!(fabs(value->f) < 2147483648.0)) return; // out of range: undefined in C++, leave it
+            ConstValue converted;
+            converted.i = (long long)value->f; // truncates, like the C++ conversion
+            v.initialValue = makeLiteral(converted);
+        }
+        else if(type == "float" && !value->isFloat){
+            ConstValue converted;
+            converted.isFloat = true;
+            converted.f = (double)value->i;
+            v.initialValue = makeLiteral(converted);
+        }
+    }
+
+    void foldStatement(StatementAST *s){ // declarations and assignments (for headers use this too)
+        if(!s) return;
+        if(auto v = nodeAs<VarDeclAST>(s)) foldDeclaration(*v);
+        else if(auto a = nodeAs<AssignmentAST>(s)) fold(a->value);
+    }
+
+    // known truth value of a condition after folding it
+    optional<bool> condition(ExprAST *&cond){
+        optional<ConstValue> value = fold(cond);
+        if(!value) return nullopt;
+        return value->truthy();
+    }
+
+    // drops the arms that can't run, returns false if none is left. Sets *always when the
+    // only arm left runs unconditionally (its body then replaces the whole if).
+    bool pruneIf(IfStatementAST &i,StatementList *&always){
+        always = nullptr;
+        for(auto &eif : i.elseIfBlocks) if(!eif.condition) return true; // a broken arm: keep the chain as it is
+        arms.clear();
+        arms.push_back({i.condition,i.thenBody});
+        arms.insert(arms.end(),i.elseIfBlocks.begin(),i.elseIfBlocks.end());
+        bool changed = false;
+        size_t kept = 0;
+        StatementList elseBody = i.elseBody;
+        bool hasElse = !i.elseBody.empty();
+        for(size_t k = 0 ; k < arms.size() ; ++k){
+            optional<bool> truth = condition(arms[k].condition);
+            if(truth && !*truth){ changed = true; continue; } // never taken
+            if(truth){ // always taken: it is the else, and nothing after it can run
+                changed = true;
+                elseBody = arms[k].body;
+                hasElse = true;
+                break;
+            }
+            arms[kept++] = arms[k];
+        }
+        arms.resize(kept);
+        if(!changed){
+            i.condition = arms[0].condition; // folded in place, same arms
+            for(size_t k = 1 ; k < arms.size() ; ++k) i.elseIfBlocks[k - 1].condition = arms[k].condition;
+            return true;
+        }
+        if(arms.empty()){
+            if(!hasElse) return false;
+            // only the else is left: it runs, so its body takes the if's place
+            i.thenBody = elseBody;
+            always = &i.thenBody;
+            return true;
+        }
+        i.condition = arms[0].condition;
+        i.thenBody = arms[0].body;
+        i.elseIfBlocks = arena->copy(arms,1);
+        i.elseBody = hasElse ? elseBody : StatementList();
+        return true;
+    }
+
+    // appends to scratch what s becomes: itself (folded), a spliced body, or nothing
+    void rewrite(StatementAST *root){
+        pending.push_back(root);
+        while(!pending.empty()){
+            StatementAST *s = pending.back();
+            pending.pop_back();
+            switch(s->kind){
+                case StmtKind::VarDecl:
+                case StmtKind::Assignment: foldStatement(s); break;
+                case StmtKind::Cout:
+                    for(auto &part : static_cast<CoutStatementAST*>(s)->parts) fold(part);
+                    break;
+                case StmtKind::Error: break;
+                case StmtKind::While:{
+                    auto w = static_cast<WhileStatementAST*>(s);
+                    optional<bool> truth = condition(w->condition);
+                    if(truth && !*truth) continue; // never runs
+                    bodies.push_back(&w->body);
+                    break;
+                }
+                case StmtKind::For:{
+                    auto f = static_cast<ForStatementAST*>(s);
+                    foldStatement(f->init);
+                    foldStatement(f->step);
+                    if(f->condition){
+                        optional<bool> truth = condition(f->condition);
+                        if(truth && !*truth){ // never runs: only the init is left
+                            if(f->init) scratch.push_back(f->init);
+                            continue;
+                        }
+                    }
+                    bodies.push_back(&f->body);
+                    break;
+                }
+                case StmtKind::If:{
+                    auto i = static_cast<IfStatementAST*>(s);
+                    StatementList *always;
+                    if(!pruneIf(*i,always)) continue;
+                    if(always){ // rewrite its statements here, in order
+                        for(size_t k = always->size() ; k-- > 0 ;) pending.push_back((*always)[k]);
+                        continue;
+                    }
+                    bodies.push_back(&i->thenBody);
+                    for(auto &eif : i->elseIfBlocks) bodies.push_back(&eif.body);
+                    if(!i->elseBody.empty()) bodies.push_back(&i->elseBody);
+                    break;
+                }
+            }
+            scratch.push_back(s);
+        }
+    }
+
+    // optimize every block queued by rewrite(), including the ones they queue
+    void drainBodies(){
+        while(!bodies.empty()){
+            StatementList *body = bodies.back();
+            bodies.pop_back();
+            size_t mark = scratch.size();
+            for(StatementAST *s : *body) rewrite(s);
+            bool same = scratch.size() - mark == body->size() && equal(scratch.begin() + mark,scratch.end(),body->begin());
+            if(!same) *body = arena->copy(scratch,mark);
+            scratch.resize(mark);
+        }
+    }
+public:
+    explicit Optimizer(SymbolTable &syms):symbols(syms){}
+
+    // appends what the top-level statement stmt becomes (none, one or several statements);
+    // new nodes go in arena, new literals in the symbol table
+    void run(StatementAST *stmt,Arena &into,vector<StatementAST*> &out){
+        arena = &into;
+        size_t mark = scratch.size();
+        rewrite(stmt);
+        out.insert(out.end(),scratch.begin() + mark,scratch.end());
+        scratch.resize(mark);
+        drainBodies();
+    }
+
+    ProgramAST run(const ProgramAST &program,Arena &into){
+        ProgramAST out;
+        for(auto *stmt : program) run(stmt,into,out);
+        return out;
+    }
+};
+
+#endif
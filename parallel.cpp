@@ -0,0 +1,156 @@
+#ifndef PARALLEL_CPP
+#define PARALLEL_CPP
+#include <bits/stdc++.h>
+#include "parser.cpp"
+using namespace std;
+
+// Parallel Translation:
+// Top-level statements don't depend on each other, so a big program is cut into
+// runs of whole statements that are parsed and emitted independently, each task
+// with its own ParseContext and output buffer. The buffers are written in source
+// order, so the output is exactly what the serial path writes.
+//
+// Cut points come from one pass over the token types: a ';' or a '}' at brace and
+// paren depth 0 ends a top-level statement (unless an 'else' follows the '}').
+// Input with errors can fool that pass, so a task whose parse reports an error is
+// not trusted: from its first token on, the rest of the input is parsed serially,
+// the way the serial path would, diagnostics included. The tasks before it parsed
+// cleanly, so the serial parser would have reached the same point in the same state.
+
+// Work-stealing pool: every worker starts on its own contiguous block of tasks,
+// taking them front to back (so the earliest tasks finish first and the writer can
+// start), and once its block is empty steals from the back of another worker's.
+class WorkStealingPool{
+    struct Queue{
+        mutex lock;
+        deque<size_t> tasks;
+    };
+    vector<Queue> queues;
+    vector<thread> workers;
+    atomic<bool> stopping{false};
+    function<void(size_t)> body;
+
+    bool take(size_t self,size_t &task){
+        {
+            lock_guard<mutex> guard(queues[self].lock);
+            if(!queues[self].tasks.empty()){
+                task = queues[self].tasks.front();
+                queues[self].tasks.pop_front();
+                return true;
+            }
+        }
+        for(size_t i = 1 ; i < queues.size() ; ++i){
+            Queue &victim = queues[(self + i) % queues.size()];
+            lock_guard<mutex> guard(victim.lock);
+            if(!victim.tasks.empty()){
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false; // nothing left anywhere: tasks are never added once running
+    }
+public:
+    WorkStealingPool(size_t taskCount,unsigned threads,function<void(size_t)> run):queues(max(1u,threads)),body(move(run)){
+        for(size_t t = 0 ; t < taskCount ; ++t) queues[t * queues.size() / taskCount].tasks.push_back(t);
+        for(size_t w = 0 ; w < queues.size() ; ++w) workers.emplace_back([this,w]{
+            size_t task;
+            while(!stopping.load(memory_order_relaxed) && take(w,task)) body(task);
+        });
+    }
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+    ~WorkStealingPool(){ join(); }
+
+    void stop(){ stopping = true; } // tasks that haven't started are dropped
+    void join(){
+        for(auto &w : workers) if(w.joinable()) w.join();
+    }
+};
+
+// Start of each run of whole top-level statements, about targetTokens long, and the
+// index of the END_OF_FILE token last. Runs never start or end inside a statement.
+vector<size_t> splitTopLevel(const TokenStream &tokens,size_t targetTokens){
+    size_t end = tokens.size() - 1; // the END_OF_FILE token
+    vector<size_t> cuts = {0};
+    long braces = 0,parens = 0;
+    for(size_t i = 0 ; i < end ; ++i){
+        bool statementEnd = false;
+        switch(tokens.types[i]){
+            case TokenType::OPEN_BRACE: ++braces; break;
+            case TokenType::CLOSE_BRACE: statementEnd = --braces == 0 && parens == 0 && tokens.types[i + 1] != TokenType::KEYWORD_ELSE; break;
+            case TokenType::OPEN_PAREN: ++parens; break;
+            case TokenType::CLOSE_PAREN: --parens; break;
+            case TokenType::SEMICOLON: statementEnd = braces == 0 && parens == 0; break;
+            default: break;
+        }
+        if(statementEnd && i + 1 - cuts.back() >= targetTokens) cuts.push_back(i + 1);
+    }
+    if(cuts.back() < end) cuts.push_back(end);
+    else if(cuts.size() == 1) cuts.push_back(end); // empty program: one empty run
+    return cuts;
+}
+
+struct ParallelOptions{
+    unsigned threads = max(1u,thread::hardware_concurrency());
+    size_t maxDepth = 10000;
+    size_t minTaskTokens = 1 << 14;    // smaller runs cost more in setup than they save
+};
+
+// Translates tokens on opt.threads workers, calling emit(program, ctx, out) on a worker
+// to append a run's Python to out (ctx is that run's own: emit may add nodes and symbols),
+// and writes the runs to outFile in order. The serial fallback after an error parses into
+// the caller's ctx. Returns the parser's diagnostics.
+template<class Emit>
+vector<string> runParallel(const TokenStream &tokens,ParseContext &ctx,ostream &outFile,Emit emit,const ParallelOptions &opt = {}){
+    size_t target = max<size_t>(opt.minTaskTokens,tokens.size() / (max(1u,opt.threads) * 16)); // enough tasks to balance
+    vector<size_t> cuts = splitTopLevel(tokens,target);
+    size_t taskCount = cuts.size() - 1;
+
+    struct Task{
+        string out;
+        bool failed = false;
+        bool ready = false;
+    };
+    vector<Task> results(taskCount);
+    mutex doneLock;
+    condition_variable doneSignal;
+
+    WorkStealingPool pool(taskCount,opt.threads,[&](size_t t){
+        ParseContext local;
+        Parser parser(tokens.slice(cuts[t],cuts[t + 1]),local);
+        parser.setMaxDepth(opt.maxDepth);
+        ProgramAST program = parser.parse();
+        bool failed = !parser.errors().empty();
+        string out;
+        if(!failed) emit(program,local,out);
+        lock_guard<mutex> guard(doneLock);
+        results[t].out = move(out);
+        results[t].failed = failed;
+        results[t].ready = true;
+        doneSignal.notify_all();
+    });
+
+    // the writer is this thread: each run goes out as soon as it and every run before it are done
+    for(size_t t = 0 ; t < taskCount ; ++t){
+        unique_lock<mutex> guard(doneLock);
+        doneSignal.wait(guard,[&]{ return results[t].ready; });
+        guard.unlock();
+        if(results[t].failed){
+            pool.stop();
+            pool.join();
+            Parser parser(tokens.slice(cuts[t],tokens.size()),ctx);
+            parser.setMaxDepth(opt.maxDepth);
+            ProgramAST program = parser.parse();
+            string out;
+            emit(program,ctx,out);
+            outFile.write(out.data(),out.size());
+            return parser.errors();
+        }
+        outFile.write(results[t].out.data(),results[t].out.size());
+        string().swap(results[t].out);
+    }
+    return {};
+}
+
+#endif
@@ -3,441 +3,918 @@
 #include <memory>
 #include <stdexcept>
 #include "lexer.cpp"
+#include "arena.cpp"
+#include "symbols.cpp"
+
+class ExprAST;
+class StatementAST;
+
+// One piece of pending output for the iterative walkers below: a node still to
+// be expanded, a symbol, or literal text. Deep trees (thousands of nested
+// parentheses or blocks) are walked with an explicit stack instead of the native one.
+struct WalkItem{
+    const ExprAST *expr = nullptr;
+    const StatementAST *stmt = nullptr;
+    string_view text;
+    Symbol sym;
+    bool isSymbol = false;
+    WalkItem(const ExprAST *e):expr(e){}
+    WalkItem(const StatementAST *s):stmt(s){}
+    WalkItem(Symbol s):sym(s),isSymbol(true){}
+    WalkItem(string_view t):text(t){}
+    WalkItem(const char *t):text(t){}
+};
+
+// Operators are stored as opcodes, not text
+enum class BinaryOp : uint8_t { Or , And , Equal , NotEqual , Less , LessEqual , Greater , GreaterEqual , Add , Sub , Mul , Div , Mod };
+enum class UnaryOp : uint8_t { Negate };
+
+constexpr string_view binaryOpText[] = {"||","&&","==","!=","<","<=",">",">=","+","-","*","/","%"};
+constexpr string_view binaryOpPython[] = {"or","and","==","!=","<","<=",">",">=","+","-","*","/","%"};
+constexpr string_view unaryOpText[] = {"-"}; // same in Python
+// how tightly each operator binds in Python (higher binds tighter); comparisons all share 4 and chain
+constexpr uint8_t binaryOpPythonPrecedence[] = {1,2,4,4,4,4,4,4,6,6,7,7,7};
+constexpr uint8_t unaryPythonPrecedence = 8,leafPythonPrecedence = 10;
+
+// Node kinds: every node records its class in a one-byte tag, so code that
+// needs the concrete node switches on it once (visitNode() below) instead of
+// trying dynamic_casts in turn. Nodes carry no vtable.
+enum class ExprKind : uint8_t { Number , Variable , String , Binary , Unary };
+enum class StmtKind : uint8_t { VarDecl , Assignment , Cout , If , For , While , Error };
 
 class ExprAST{
 public:
-    virtual ~ExprAST(){}
-    virtual void print() const = 0;
-    virtual string toPython(int indent = 0) const = 0;
+    const ExprKind kind;
+    void print(const SymbolTable &syms) const;          // dispatch on kind, defined below the node classes
+    string toPython(const SymbolTable &syms) const;
+    // nodes with children push their pieces in output order and return true;
+    // leaves print themselves, or append their Python to out
+    bool expandPrint(vector<WalkItem> &) const { return false; }
+    bool expandPython(vector<WalkItem> &) const { return false; }
+    bool expandPythonMinimal(vector<WalkItem> &) const { return false; } // only the parentheses Python needs
+    void writePython(const SymbolTable &,string &) const {}
+    uint8_t pythonPrecedence() const;
+protected:
+    explicit ExprAST(ExprKind k):kind(k){}
 };
 
 class StatementAST{
     public:
-    virtual ~StatementAST(){}
-    virtual void print() const = 0;
+    const StmtKind kind;
+    void print(const SymbolTable &syms) const;
+    bool expandPrint(vector<WalkItem> &) const { return false; }
+protected:
+    explicit StatementAST(StmtKind k):kind(k){}
 };
 
-using ProgramAST = vector<unique_ptr<StatementAST>> ;
+// iterative print()/toPython() for nodes with children, defined below the node classes
+void dumpAST(WalkItem root,const SymbolTable &syms);
+void exprToPython(const ExprAST &expr,const SymbolTable &syms,string &out,bool minimalParens = false);
+
+// Nodes live in a ParseContext's arena and are never deleted one by one;
+// a program is just the list of its top-level statements.
+using ProgramAST = vector<StatementAST*> ;
+using StatementList = ArenaSpan<StatementAST*> ;
+
+// Names and literals below are Symbols: ids into the ParseContext's SymbolTable,
+// which every print()/toPython() needs to spell them out.
 
 //Defintion of specific AST Node class
 class NumberExprAST:public ExprAST{
-    string value;
 public:
-    NumberExprAST(string val):value(val){}
-    void print() const override{
-        cout << "Number("<<value<<")";
+    static constexpr ExprKind Kind = ExprKind::Number;
+    Symbol value;
+    NumberExprAST(Symbol val):ExprAST(Kind),value(val){}
+    void print(const SymbolTable &syms) const{
+        cout << "Number("<<syms[value]<<")";
     }
-    string toPython(int indent = 0) const override {
-        return value;
+    void writePython(const SymbolTable &syms,string &out) const{
+        out += syms[value];
     }
 };
 
 class VariableExprAST:public ExprAST{
-    string name;
 public:
-    VariableExprAST(string n):name(n){}
-    void print() const override{
-        cout << "Variable("<<name<<")";
+    static constexpr ExprKind Kind = ExprKind::Variable;
+    Symbol name;
+    VariableExprAST(Symbol n):ExprAST(Kind),name(n){}
+    void print(const SymbolTable &syms) const{
+        cout << "Variable("<<syms[name]<<")";
     }
-    string toPython(int indent = 0) const override {
+    void writePython(const SymbolTable &syms,string &out) const{
         // variable name is same in python
-        return name;
+        out += syms[name];
     }
 };
 
 class StringLiteralExprAST:public ExprAST{
     public:
-    string value;
-    StringLiteralExprAST(string val):value(val){}
-    void print() const override{
-        cout << "String(\""<<value<<"\")";
+    static constexpr ExprKind Kind = ExprKind::String;
+    Symbol value; // without the quotes
+    StringLiteralExprAST(Symbol val):ExprAST(Kind),value(val){}
+    void print(const SymbolTable &syms) const{
+        cout << "String(\""<<syms[value]<<"\")";
     }
-    string toPython(int indent = 0) const override {
+    void writePython(const SymbolTable &syms,string &out) const{
         // produce a quoted Python string; escape backslashes and quotes
-        string s = "\"";
-        for(char c : value){
-            if(c == '\\' || c == '"'){ s.push_back('\\'); s.push_back(c); }
-            else s.push_back(c);
+        out.push_back('"');
+        for(char c : syms[value]){
+            if(c == '\\' || c == '"') out.push_back('\\');
+            out.push_back(c);
         }
-        s.push_back('"');
-        return s;
+        out.push_back('"');
     }
 };
 
 // Binary op e.g. a+b or x > 5
 class BinaryExprAST:public ExprAST{
     public:
-    string op;
-    unique_ptr<ExprAST>left;
-    unique_ptr<ExprAST>right;
-    BinaryExprAST(string o,unique_ptr<ExprAST>l,unique_ptr<ExprAST>r){
-        op = o;
-        left = move(l);
-        right = move(r);
-    }
-    void print() const override{
-        cout << "BinaryOp("<<op<<",";
-        left->print();
-        cout << ",";
-        right->print();
-        cout << ")";
-    }
-    string toPython(int indent = 0) const override {
-        string mop = op;
-        if(mop == "&&") mop = "and";
-        if(mop == "||") mop = "or";
-        return "(" + left->toPython() + " " + mop + " " + right->toPython() + ")";
+    static constexpr ExprKind Kind = ExprKind::Binary;
+    BinaryOp op;
+    ExprAST *left;
+    ExprAST *right;
+    BinaryExprAST(BinaryOp o,ExprAST *l,ExprAST *r):ExprAST(Kind),op(o),left(l),right(r){}
+    void print(const SymbolTable &syms) const{ dumpAST(this,syms); }
+    bool expandPrint(vector<WalkItem> &work) const{
+        work.insert(work.end(),{"BinaryOp(",binaryOpText[(int)op],",",left,",",right,")"});
+        return true;
+    }
+    bool expandPython(vector<WalkItem> &work) const{
+        work.insert(work.end(),{"(",left," ",binaryOpPython[(int)op]," ",right,")"});
+        return true;
+    }
+    // a - (b - c) and (a < b) == c keep theirs: operators group left to right, comparisons would chain
+    bool expandPythonMinimal(vector<WalkItem> &work) const{
+        uint8_t precedence = binaryOpPythonPrecedence[(int)op];
+        bool comparison = precedence == 4;
+        uint8_t leftPrecedence = left->pythonPrecedence();
+        if(leftPrecedence < precedence || (comparison && leftPrecedence == precedence)) work.insert(work.end(),{"(",left,")"});
+        else work.push_back(left);
+        work.insert(work.end(),{" ",binaryOpPython[(int)op]," "});
+        if(right->pythonPrecedence() <= precedence) work.insert(work.end(),{"(",right,")"});
+        else work.push_back(right);
+        return true;
+    }
+};
+
+// Unary op e.g. -x
+class UnaryExprAST:public ExprAST{
+    public:
+    static constexpr ExprKind Kind = ExprKind::Unary;
+    UnaryOp op;
+    ExprAST *operand;
+    UnaryExprAST(UnaryOp o,ExprAST *e):ExprAST(Kind),op(o),operand(e){}
+    void print(const SymbolTable &syms) const{ dumpAST(this,syms); }
+    bool expandPrint(vector<WalkItem> &work) const{
+        work.insert(work.end(),{"UnaryOp(",unaryOpText[(int)op],",",operand,")"});
+        return true;
+    }
+    bool expandPython(vector<WalkItem> &work) const{
+        work.insert(work.end(),{"(",unaryOpText[(int)op],operand,")"});
+        return true;
+    }
+    bool expandPythonMinimal(vector<WalkItem> &work) const{
+        if(operand->pythonPrecedence() <= unaryPythonPrecedence) work.insert(work.end(),{unaryOpText[(int)op],"(",operand,")"});
+        else work.insert(work.end(),{unaryOpText[(int)op],operand});
+        return true;
     }
 };
 
 // Define Specific AST Node classes (statements):
 class VarDeclAST:public StatementAST{ //e.g. int x = 10;
 public:
-    string varType;
-    string varName;
-    unique_ptr<ExprAST>initialValue; // can be nullptr if no value is assigned
-    VarDeclAST(string type,string name,unique_ptr<ExprAST>value){
-        varType = type;
-        varName = name;
-        initialValue = move(value);
-    }
-    void print() const override{
-        cout << "VarDecl(Type: "<<varType << ",Name: "<<varName;
-        if(initialValue){
-            cout <<",Value: ";
-            initialValue->print();
-        }
-        cout << ")\n";
+    static constexpr StmtKind Kind = StmtKind::VarDecl;
+    Symbol varType;
+    Symbol varName;
+    ExprAST *initialValue; // can be nullptr if no value is assigned
+    VarDeclAST(Symbol type,Symbol name,ExprAST *value):StatementAST(Kind),varType(type),varName(name),initialValue(value){}
+    void print(const SymbolTable &syms) const{ dumpAST(this,syms); }
+    bool expandPrint(vector<WalkItem> &work) const{
+        work.insert(work.end(),{"VarDecl(Type: ",varType,",Name: ",varName});
+        if(initialValue) work.insert(work.end(),{",Value: ",initialValue});
+        work.push_back(")\n");
+        return true;
     }
 };
 
 // statement node for assignment e.g. x = 20;
 class AssignmentAST:public StatementAST{
 public:
-    string varName;
-    unique_ptr<ExprAST>value;
-    AssignmentAST(string name , unique_ptr<ExprAST>val){
-        varName = name;
-        value = move(val);
-    }
-    void print() const override{
-        cout << "Assignment(Name: "<<varName<<",Value: ";
-        value->print();
-        cout << ")\n";
+    static constexpr StmtKind Kind = StmtKind::Assignment;
+    Symbol varName;
+    ExprAST *value;
+    AssignmentAST(Symbol name , ExprAST *val):StatementAST(Kind),varName(name),value(val){}
+    void print(const SymbolTable &syms) const{ dumpAST(this,syms); }
+    bool expandPrint(vector<WalkItem> &work) const{
+        work.insert(work.end(),{"Assignment(Name: ",varName,",Value: ",value,")\n"});
+        return true;
     }
 };
 // For cout:
 class CoutStatementAST:public StatementAST{
     public:
+    static constexpr StmtKind Kind = StmtKind::Cout;
     // A cout can have multiple '<<' parts
-    vector<unique_ptr<ExprAST>>parts;
+    ArenaSpan<ExprAST*>parts;
     bool hasEndl;
 
-    CoutStatementAST():hasEndl(false){}
+    CoutStatementAST():StatementAST(Kind),hasEndl(false){}
 
-    void print() const override{
-        cout << "CoutStatement(";
+    void print(const SymbolTable &syms) const{ dumpAST(this,syms); }
+    bool expandPrint(vector<WalkItem> &work) const{
+        work.push_back("CoutStatement(");
         for(size_t i = 0 ; i < parts.size();++i){
-            parts[i]->print();
-            if(i<parts.size()-1) cout <<",";
+            work.push_back(parts[i]);
+            if(i<parts.size()-1) work.push_back(",");
         }
         if(hasEndl){
-            if(!parts.empty()) cout << ",";
-            cout << "ENDL";
+            if(!parts.empty()) work.push_back(",");
+            work.push_back("ENDL");
         }
-        cout << ")\n";
+        work.push_back(")\n");
+        return true;
     }
 };
 // Placeholder for 'if' statement
+struct ElseIfBlock{
+    ExprAST *condition; // nullptr for an arm that failed to parse; its body is just the error marker
+    StatementList body;
+};
+
 class IfStatementAST : public StatementAST {
 public:
-    unique_ptr<ExprAST>condition;
-    vector<unique_ptr<StatementAST>>thenBody;
-    vector<unique_ptr<StatementAST>>elseBody;
-    vector<pair<unique_ptr<ExprAST>,vector<unique_ptr<StatementAST>>>>elseIfBlocks;
-
-    void print() const override{
-        cout << "IfStatement(Condition: ";
-        condition->print();
-        cout << ", Then: [";
-        for(auto &s:thenBody) s->print();
-        cout << "]";
+    static constexpr StmtKind Kind = StmtKind::If;
+    ExprAST *condition = nullptr;
+    StatementList thenBody;
+    StatementList elseBody;
+    ArenaSpan<ElseIfBlock>elseIfBlocks;
+
+    IfStatementAST():StatementAST(Kind){}
+    void print(const SymbolTable &syms) const{ dumpAST(this,syms); }
+    bool expandPrint(vector<WalkItem> &work) const{
+        work.insert(work.end(),{"IfStatement(Condition: ",condition,", Then: ["});
+        work.insert(work.end(),thenBody.begin(),thenBody.end());
+        work.push_back("]");
         for(auto &block: elseIfBlocks){
-            cout << " ElseIf(";
-            block.first->print();
-            cout <<", [";
-            for(auto &s:block.second) s->print();
-            cout << "])";
+            if(!block.condition){ work.insert(work.end(),block.body.begin(),block.body.end()); continue; }
+            work.insert(work.end(),{" ElseIf(",block.condition,", ["});
+            work.insert(work.end(),block.body.begin(),block.body.end());
+            work.push_back("])");
         }
         if(!elseBody.empty()){
-            cout << " Else: [";
-            for(auto &s:elseBody) s->print();
-            cout <<"]";
+            work.push_back(" Else: [");
+            work.insert(work.end(),elseBody.begin(),elseBody.end());
+            work.push_back("]");
         }
-        cout << ")\n";
+        work.push_back(")\n");
+        return true;
     }
 };
 
-// Placeholder for 'for' loop
+// 'for' loop e.g. for (int i = 0; i < n; i += 2) { ... }
+// The header is parsed like any other code; each part may be missing (nullptr).
 class ForStatementAST : public StatementAST {
 public:
-    string init,condition,increment;
-    vector<unique_ptr<StatementAST>>body;
-    void print() const override{
-        cout << "ForStatement(Init: "<<init <<", Cond: "<<condition<<", Inc: "<<increment<<", Body: [";
-        for(auto &s:body) s->print();
-        cout <<"])\n";
+    static constexpr StmtKind Kind = StmtKind::For;
+    StatementAST *init = nullptr;      // VarDeclAST or AssignmentAST
+    ExprAST *condition = nullptr;
+    AssignmentAST *step = nullptr;     // i++, i -= 2 ... arrive as i = (i + 1), i = (i - 2)
+    StatementList body;
+    ForStatementAST():StatementAST(Kind){}
+    void print(const SymbolTable &syms) const{ dumpAST(this,syms); }
+    bool expandPrint(vector<WalkItem> &work) const{
+        work.push_back("ForStatement(Init: ");
+        if(init) work.push_back(init);
+        work.push_back(", Cond: ");
+        if(condition) work.push_back(condition);
+        work.push_back(", Inc: ");
+        if(step) work.push_back((const StatementAST*)step);
+        work.push_back(", Body: [");
+        work.insert(work.end(),body.begin(),body.end());
+        work.push_back("])\n");
+        return true;
     }
 };
 
 // Placeholder for 'while' loop
 class WhileStatementAST : public StatementAST {
 public:
-    unique_ptr<ExprAST> condition;
-    vector<unique_ptr<StatementAST>> body;
-    void print() const override{
-        cout << "WhileStatement(Cond: ";
-        condition->print();
-        cout <<", Body: [";
-        for(auto &s:body) s->print();
-        cout << "])\n";
+    static constexpr StmtKind Kind = StmtKind::While;
+    ExprAST *condition = nullptr;
+    StatementList body;
+    WhileStatementAST():StatementAST(Kind){}
+    void print(const SymbolTable &syms) const{ dumpAST(this,syms); }
+    bool expandPrint(vector<WalkItem> &work) const{
+        work.insert(work.end(),{"WhileStatement(Cond: ",condition,", Body: ["});
+        work.insert(work.end(),body.begin(),body.end());
+        work.push_back("])\n");
+        return true;
     }
 };
 
+// A statement that failed to parse. The parser skips ahead to the next ';' or
+// '}' and leaves one of these where the bad tokens were, so the rest of the
+// program still gets translated.
+class ErrorStatementAST : public StatementAST {
+public:
+    static constexpr StmtKind Kind = StmtKind::Error;
+    string_view message; // the diagnostic, copied into the arena
+    ErrorStatementAST(string_view m):StatementAST(Kind),message(m){}
+    void print(const SymbolTable &) const{ cout << "Error(" << message << ")\n"; }
+};
+
+// Static dispatch:
+// visitNode(node, f) calls f with the node as its concrete class, chosen by one
+// switch on the kind tag. Pass a generic lambda, or Overloaded{...} with one
+// lambda per class, e.g.
+//   visitNode(stmt,Overloaded{[&](const IfStatementAST &i){ ... },[&](const auto &other){ ... }});
+template<class... Fs> struct Overloaded : Fs... { using Fs::operator()...; };
+template<class... Fs> Overloaded(Fs...) -> Overloaded<Fs...>;
+
+template<class F>
+decltype(auto) visitNode(const ExprAST &e,F &&f){
+    switch(e.kind){
+        case ExprKind::Number: return f(static_cast<const NumberExprAST&>(e));
+        case ExprKind::Variable: return f(static_cast<const VariableExprAST&>(e));
+        case ExprKind::String: return f(static_cast<const StringLiteralExprAST&>(e));
+        case ExprKind::Binary: return f(static_cast<const BinaryExprAST&>(e));
+        case ExprKind::Unary: break;
+    }
+    return f(static_cast<const UnaryExprAST&>(e));
+}
+
+template<class F>
+decltype(auto) visitNode(const StatementAST &s,F &&f){
+    switch(s.kind){
+        case StmtKind::VarDecl: return f(static_cast<const VarDeclAST&>(s));
+        case StmtKind::Assignment: return f(static_cast<const AssignmentAST&>(s));
+        case StmtKind::Cout: return f(static_cast<const CoutStatementAST&>(s));
+        case StmtKind::If: return f(static_cast<const IfStatementAST&>(s));
+        case StmtKind::For: return f(static_cast<const ForStatementAST&>(s));
+        case StmtKind::While: return f(static_cast<const WhileStatementAST&>(s));
+        case StmtKind::Error: break;
+    }
+    return f(static_cast<const ErrorStatementAST&>(s));
+}
+
+// node as a T if it is one, else nullptr (also for a null node): a dynamic_cast done by kind tag
+template<class T,class Node>
+const T *nodeAs(const Node *node){
+    return node && node->kind == T::Kind ? static_cast<const T*>(node) : nullptr;
+}
+template<class T,class Node>
+T *nodeAs(Node *node){ // for passes that rewrite the tree
+    return node && node->kind == T::Kind ? static_cast<T*>(node) : nullptr;
+}
+
+inline void ExprAST::print(const SymbolTable &syms) const{ visitNode(*this,[&](const auto &n){ n.print(syms); }); }
+inline uint8_t ExprAST::pythonPrecedence() const{
+    if(auto b = nodeAs<BinaryExprAST>(this)) return binaryOpPythonPrecedence[(int)b->op];
+    return kind == ExprKind::Unary ? unaryPythonPrecedence : leafPythonPrecedence;
+}
+inline string ExprAST::toPython(const SymbolTable &syms) const{
+    string s;
+    exprToPython(*this,syms,s);
+    return s;
+}
+inline void StatementAST::print(const SymbolTable &syms) const{ visitNode(*this,[&](const auto &n){ n.print(syms); }); }
+
+// Iterative walkers:
+// A node's expand*() appends its pieces in output order; we reverse them so the
+// first piece is on top of the stack, then keep popping. Leaves print themselves.
+inline void reverseFrom(vector<WalkItem> &work,size_t mark){
+    reverse(work.begin() + mark,work.end());
+}
+
+void dumpAST(WalkItem root,const SymbolTable &syms){
+    vector<WalkItem> work;
+    // the root prints through here, so expand it directly rather than calling its print() again
+    auto expand = [&](const auto &n){ return n.expandPrint(work); };
+    if(root.expr) visitNode(*root.expr,expand);
+    else visitNode(*root.stmt,expand);
+    reverseFrom(work,0);
+    while(!work.empty()){
+        WalkItem item = work.back();
+        work.pop_back();
+        size_t mark = work.size();
+        auto step = [&](const auto &n){ if(n.expandPrint(work)) reverseFrom(work,mark); else n.print(syms); };
+        if(item.expr) visitNode(*item.expr,step);
+        else if(item.stmt) visitNode(*item.stmt,step);
+        else if(item.isSymbol) cout << syms[item.sym];
+        else cout << item.text;
+    }
+}
+
+// every operator parenthesized, or (minimalParens) only where Python's precedence needs it
+void exprToPython(const ExprAST &expr,const SymbolTable &syms,string &out,bool minimalParens){
+    thread_local vector<WalkItem> work; // reused: codegen calls this once per expression
+    size_t base = work.size();
+    work.push_back(&expr);
+    while(work.size() > base){
+        WalkItem item = work.back();
+        work.pop_back();
+        size_t mark = work.size();
+        if(!item.expr) out += item.text;
+        else visitNode(*item.expr,[&](const auto &n){
+            if(minimalParens ? n.expandPythonMinimal(work) : n.expandPython(work)) reverseFrom(work,mark);
+            else n.writePython(syms,out);
+        });
+    }
+}
+
+// Binary operators, C++ precedence (higher binds tighter). 0 = not a binary operator.
+struct BinaryOpInfo{
+    uint8_t precedence = 0;
+    bool rightAssoc = false;
+    BinaryOp op = BinaryOp::Or;
+};
+
+constexpr array<BinaryOpInfo,256> makeBinaryOpTable(){
+    array<BinaryOpInfo,256> table{};
+    auto set = [&](TokenType t,uint8_t precedence,BinaryOp op){
+        table[(uint8_t)t].precedence = precedence;
+        table[(uint8_t)t].op = op;
+    };
+    set(TokenType::OR_OR,1,BinaryOp::Or);
+    set(TokenType::AND_AND,2,BinaryOp::And);
+    set(TokenType::DOUBLE_EQUALS,3,BinaryOp::Equal);     set(TokenType::NOT_EQUAL,3,BinaryOp::NotEqual);
+    set(TokenType::LESS_THAN,4,BinaryOp::Less);          set(TokenType::LESS_THAN_EQUAL,4,BinaryOp::LessEqual);
+    set(TokenType::GREATER_THAN,4,BinaryOp::Greater);    set(TokenType::GREATER_THAN_EQUAL,4,BinaryOp::GreaterEqual);
+    set(TokenType::PLUS,5,BinaryOp::Add);                set(TokenType::MINUS,5,BinaryOp::Sub);
+    set(TokenType::MULTIPLY,6,BinaryOp::Mul);            set(TokenType::DIVIDE,6,BinaryOp::Div);      set(TokenType::MODULO,6,BinaryOp::Mod);
+    return table;
+}
+constexpr array<BinaryOpInfo,256> binaryOps = makeBinaryOpTable();
+
+// Parse Context:
+// Owns the memory of every AST node built while parsing. Nodes and their child
+// arrays are bump-allocated in one arena, so freeing a whole program is just
+// dropping the context (or arena.reset() to reuse it for the next statement).
+// The symbols outlive arena.reset(): ids stay valid across streamed statements.
+struct ParseContext{
+    Arena arena;
+    SymbolTable symbols;
+};
+
 // Parser Class
 class Parser{
-    vector<Token>tokens;
-    int pos;
+    TokenStream tokens;     // all tokens, or just the lookahead window when streaming
+    size_t pos;
+    Lexer *lexer = nullptr; // set when streaming: tokens are pulled on demand
+    function<void(TokenStream&)> pullTokens; // or set when another thread lexes: appends the next batch
+    unique_ptr<LineIndex> lines; // only built once we have an error to report
+    Arena *arena;
+    SymbolTable &symbols;
+    vector<StatementAST*> scratch;   // children of the blocks being parsed, copied out when a block closes
+    vector<ExprAST*> exprScratch;
+    vector<ElseIfBlock> elseIfScratch;
+    size_t maxDepth = 10000; // open blocks / pending expression operators before we give up
+
+    // Parsing uses explicit stacks instead of recursion, so nesting depth is
+    // bounded by maxDepth rather than by the native stack.
+
+    // an operator the expression loop is holding: a prefix '-' or '(' waiting for its
+    // operand, or a binary operator waiting for its right-hand side
+    struct PendingOp{
+        enum Kind : uint8_t { Unary , Paren , Binary } kind;
+        uint8_t precedence;
+        BinaryOp op;
+        ExprAST *left;
+    };
+    vector<PendingOp> ops;
+
+    // an if/for/while whose '{' we've consumed but whose '}' we haven't seen yet
+    struct OpenBlock{
+        StatementAST *node;
+        StatementList *body;         // where the block's statements go; nullptr for an else-if arm
+        IfStatementAST *ifNode;      // set for if statements, which may continue with else / else if
+        ExprAST *elseIfCondition;    // condition of the else-if arm being parsed
+        size_t firstStmt;            // this block's statements start here in scratch
+        size_t firstElseIf;          // and its else-if arms here in elseIfScratch
+    };
+    vector<OpenBlock> blocks;
+
+    // Error recovery: every error is recorded, the parser skips to the next
+    // statement and keeps going, so one pass reports every problem.
+    vector<string> diagnostics;
+    bool inElseHeader = false;  // between a '}' and the '{' of the next else / else-if arm
+    bool resumeArm = false;     // a broken arm was skipped: look for the next one
+    bool reportedEof = false;   // blocks still open at end of input (reported once)
+
+    bool streaming() const{ return lexer || pullTokens; }
+
+    size_t fill(size_t i){ // index of token i, pulling it from the lexer when streaming
+        while(streaming() && i >= tokens.size() && (tokens.size() == 0 || tokens.types.back() != TokenType::END_OF_FILE)){
+            if(lexer) tokens.push(lexer->nextToken());
+            else pullTokens(tokens);
+        }
+        return min(i,tokens.size() - 1); // past the end we keep seeing EOF
+    }
+
+    TokenType current(){
+        return tokens.types[fill(pos)]; // current token type;
+    }
 
-    Token &current(){
-        return tokens[pos]; // current token;
+    TokenType next(){
+        return tokens.types[fill(pos+1)]; // next token type
     }
 
-    Token &next(){
-        return tokens[pos+1]; // next token
+    string_view currentText(){ // only needed when building leaves/names
+        return tokens.text(fill(pos));
     }
 
     void advance(){
-        if(pos <(int)tokens.size()) ++pos;
+        if(current() != TokenType::END_OF_FILE) ++pos;
+        // streaming: drop what we've moved past so memory stays proportional to the lookahead
+        // (batches arrive thousands of tokens at a time, so wait until half the window is behind us)
+        if(streaming() && pos >= 64 && pos * 2 >= tokens.size()){
+            tokens.dropFront(pos);
+            pos = 0;
+        }
+    }
+
+    // errors point at the current token as line:col
+    string located(const string &message){
+        if(!lines) lines = make_unique<LineIndex>(tokens.source);
+        return "Parser Error at "+lines->describe(tokens.offsets[fill(pos)])+": "+message;
+    }
+    [[noreturn]] void error(const string &message){
+        throw runtime_error(located(message)); // caught by parseStatement(), which recovers
     }
 
     // check if current token matches a type if yes then consume it else throws an error
 
     void consume(TokenType type , const string &message){
-        if(current().type == type) advance();
-        else throw runtime_error("Parser Error: "+message+". Got "+ tokenTypeToString(current().type));
+        if(current() == type) advance();
+        else error(message+". Got "+ tokenTypeToString(current()));
+    }
+
+    void pushOp(PendingOp op){
+        if(ops.size() >= maxDepth) error("expression nested too deeply (limit "+to_string(maxDepth)+")");
+        ops.push_back(op);
+    }
+
+    // fold pending binary operators that bind tighter than an incoming operator into 'right'
+    // (equally tight ones too, unless the incoming operator is right-associative)
+    ExprAST* reduce(ExprAST *right,int precedence,bool rightAssoc = false){
+        while(!ops.empty() && ops.back().kind == PendingOp::Binary){
+            const PendingOp &top = ops.back();
+            if(top.precedence < precedence || (top.precedence == precedence && rightAssoc)) break;
+            right = arena->make<BinaryExprAST>(top.op,top.left,right);
+            ops.pop_back();
+        }
+        return right;
     }
 
 
 
-    //Parser Function(Recursive Descent)
-    unique_ptr<ExprAST> parseExpression();
-    unique_ptr<ExprAST> parseTerm();
-    unique_ptr<ExprAST> parseFactor();
-    unique_ptr<ExprAST> parseAtom();
-    unique_ptr<ExprAST> parseComparison();
+    //Parser Function(operator-precedence loop for expressions, block stack for statements)
+    ExprAST* parseExpression();
+    ExprAST* parseAtom();
 
-    unique_ptr<StatementAST> parseVariableDeclaration();
-    unique_ptr<StatementAST> parseAssignmentStatement();
-    unique_ptr<StatementAST> parseCoutStatement();
-    unique_ptr<StatementAST> parseIfStatement();
-    unique_ptr<StatementAST> parseForStatement();
-    unique_ptr<StatementAST> parseWhileStatement();
-    unique_ptr<StatementAST> parseStatement();
+    StatementAST* parseVariableDeclaration();
+    StatementAST* parseAssignmentStatement();
+    StatementAST* parseDeclaration();   // the parts before ';', shared with the for header
+    AssignmentAST* parseUpdate();
+    StatementAST* parseCoutStatement();
+    void parseIfHeader();       // headers: parse up to and including '{', then open the block
+    void parseForHeader();
+    void parseWhileHeader();
+    StatementAST* parseStatement();
 
-    vector<unique_ptr<StatementAST>>parseBlock(); // Block Parsing
+    void openBlock(StatementAST *node,StatementList *body,IfStatementAST *ifNode = nullptr);
+    StatementAST* closeBlock();  // at '}': the finished statement, or nullptr if an else arm follows
+    StatementAST* nextArm();     // after an if arm: open the next else / else-if arm, or finish the if
+
+    void synchronize();
+    StatementAST* recover(const runtime_error &e);
 
 public:
-    Parser(vector<Token>t):tokens(move(t)),pos(0){}
+    Parser(TokenStream t,ParseContext &ctx):tokens(move(t)),pos(0),arena(&ctx.arena),symbols(ctx.symbols){}
+    Parser(Lexer &l,ParseContext &ctx):pos(0),lexer(&l),arena(&ctx.arena),symbols(ctx.symbols){ tokens.source = l.source(); } // streaming: lex as we parse
+    // pipelined: tokens of 'source' arrive in batches from pull, the last one ending in END_OF_FILE
+    Parser(string_view source,function<void(TokenStream&)> pull,ParseContext &ctx)
+        :pos(0),pullTokens(move(pull)),arena(&ctx.arena),symbols(ctx.symbols){ tokens.source = source; }
+    void useArena(Arena &a){ arena = &a; } // between top-level statements only
+    void setMaxDepth(size_t depth){ maxDepth = max<size_t>(depth,1); }
     ProgramAST parse();
+    StatementAST *parseNext();   // one top-level statement, nullptr at end of input
+    const vector<string> &errors() const { return diagnostics; } // every error so far, in source order
 };
 
-//Expression Parsing
-unique_ptr<ExprAST> Parser::parseAtom(){ //parse 'x','10',etc
-    if(current().type == TokenType::NUMBER_LITERAL){
-        string val = current().value;advance();
-        return make_unique<NumberExprAST>(val);
-    }
-    if(current().type == TokenType::IDENTIFIER){
-        string name = current().value; advance();
-        return make_unique<VariableExprAST>(name);
-    }
-    if(current().type == TokenType::STRING_LITERAL){
-        string val = current().value; advance();
-        return make_unique<StringLiteralExprAST>(val);
-    }
-    throw runtime_error("Expected atom.");
-}
-
-//Parse (---) and atom
-unique_ptr<ExprAST>Parser::parseFactor(){
-    if(current().type == TokenType::OPEN_PAREN){
-        advance();
-        auto expr = parseComparison();
-        consume(TokenType::CLOSE_PAREN,"')'");
-        return expr;
+//Expression Parsing (operator precedence with an explicit stack)
+// Prefix '-' and '(' wait on the ops stack until their operand is complete.
+// A binary operator first folds every pending operator that binds at least
+// as tightly (precedence from binaryOps), then waits for its right operand.
+// Parenthesized input nests on the ops stack, never on the native stack.
+ExprAST* Parser::parseExpression(){
+    ops.clear(); // expressions never contain statements, so this is never re-entered
+    size_t openParens = 0;
+    for(;;){
+        // operand position
+        for(;;){
+            if(current() == TokenType::MINUS) pushOp({PendingOp::Unary,0,{},nullptr});
+            else if(current() == TokenType::OPEN_PAREN){ pushOp({PendingOp::Paren,0,{},nullptr}); ++openParens; }
+            else break;
+            advance();
+        }
+        ExprAST *operand = parseAtom();
+
+        // operator position
+        for(;;){
+            while(!ops.empty() && ops.back().kind == PendingOp::Unary){ // prefix '-' binds tighter than any binary operator
+                operand = arena->make<UnaryExprAST>(UnaryOp::Negate,operand);
+                ops.pop_back();
+            }
+            const BinaryOpInfo &info = binaryOps[(uint8_t)current()];
+            if(info.precedence){
+                operand = reduce(operand,info.precedence,info.rightAssoc);
+                pushOp({PendingOp::Binary,info.precedence,info.op,operand});
+                advance();
+                break;
+            }
+            if(openParens && current() == TokenType::CLOSE_PAREN){
+                operand = reduce(operand,0);
+                ops.pop_back(); // the matching Paren
+                --openParens;
+                advance();
+                continue;
+            }
+            operand = reduce(operand,0);
+            if(openParens) consume(TokenType::CLOSE_PAREN,"')'"); // reports the missing ')'
+            return operand;
+        }
     }
-    return parseAtom();
 }
 
-// parse + , -
-unique_ptr<ExprAST>Parser::parseExpression(){
-    auto left = parseTerm();
-    while(current().type == TokenType::PLUS || current().type == TokenType::MINUS){
-        string op = (current().type == TokenType::PLUS)?"+":"-";
-        advance();
-        auto right = parseTerm();
-        left = make_unique<BinaryExprAST>(op,move(left),move(right));
+// atoms like 'x','10',"hi"
+ExprAST* Parser::parseAtom(){
+    switch(current()){
+        case TokenType::NUMBER_LITERAL:{
+            Symbol val = symbols.intern(currentText());advance();
+            return arena->make<NumberExprAST>(val);
+        }
+        case TokenType::IDENTIFIER:{
+            Symbol name = symbols.intern(currentText()); advance();
+            return arena->make<VariableExprAST>(name);
+        }
+        case TokenType::STRING_LITERAL:{
+            Symbol val = symbols.intern(currentText()); advance();
+            return arena->make<StringLiteralExprAST>(val);
+        }
+        default: error("Expected atom. Got "+tokenTypeToString(current()));
     }
-    return left;
 }
 
-// parse * , /
-unique_ptr<ExprAST>Parser::parseTerm(){
-    auto left = parseFactor();
-    while(current().type == TokenType::MULTIPLY || current().type == TokenType::DIVIDE){
-        string op = (current().type == TokenType::MULTIPLY)?"*":"/";
+//Parsing Statement
+StatementAST* Parser::parseDeclaration(){ //int x = 10
+    Symbol type = symbols.intern(currentText()); advance();
+    string_view name = currentText();
+    consume(TokenType::IDENTIFIER,"variable name");
+    ExprAST* val = nullptr;
+    if(current() == TokenType::EQUALS){
         advance();
-        auto right = parseFactor();
-        left = make_unique<BinaryExprAST>(op,move(left),move(right));
+        val = parseExpression();
     }
-    return left;
+    return arena->make<VarDeclAST>(type , symbols.intern(name) , val);
 }
 
-// parse comparison operators
-unique_ptr<ExprAST>Parser::parseComparison(){
-    auto left = parseExpression();
-    while(current().type == TokenType::GREATER_THAN ||
-          current().type == TokenType::LESS_THAN ||
-          current().type == TokenType::GREATER_THAN_EQUAL ||
-          current().type == TokenType::LESS_THAN_EQUAL ||
-          current().type == TokenType::DOUBLE_EQUALS ||
-          current().type == TokenType::NOT_EQUAL){
-        string op = current().value;
-        advance();
-        auto right = parseExpression();
-        left = make_unique<BinaryExprAST>(op, move(left), move(right));
-    }
-    return left;
+// x = 5, and the compound forms spelled as plain assignments:
+// x += e => x = (x + e), x -= e => x = (x - e), x++ / ++x => x = (x + 1), x-- / --x => x = (x - 1)
+AssignmentAST* Parser::parseUpdate(){
+    TokenType op = current();
+    bool prefix = op == TokenType::PLUS_PLUS || op == TokenType::MINUS_MINUS;
+    if(prefix) advance();
+    string_view text = currentText();
+    consume(TokenType::IDENTIFIER,"variable name");
+    Symbol name = symbols.intern(text);
+    if(!prefix) op = current();
+
+    ExprAST *amount;
+    switch(op){
+        case TokenType::PLUS_PLUS:
+        case TokenType::MINUS_MINUS:
+            if(!prefix) advance();
+            amount = arena->make<NumberExprAST>(symbols.intern("1"));
+            break;
+        case TokenType::PLUS_EQUALS:
+        case TokenType::MINUS_EQUALS:
+            advance();
+            amount = parseExpression();
+            break;
+        default:
+            consume(TokenType::EQUALS,"'='");
+            return arena->make<AssignmentAST>(name,parseExpression());
+    }
+    BinaryOp arith = op == TokenType::PLUS_PLUS || op == TokenType::PLUS_EQUALS ? BinaryOp::Add : BinaryOp::Sub;
+    return arena->make<AssignmentAST>(name,arena->make<BinaryExprAST>(arith,arena->make<VariableExprAST>(name),amount));
 }
 
-//Parsing Statement
-unique_ptr<StatementAST> Parser::parseVariableDeclaration(){ //int x = 10;
-    string type = current().value; advance();
-    string name = current().value;
-    consume(TokenType::IDENTIFIER,"variable name");
-    unique_ptr<ExprAST> val = nullptr;
-    if(current().type == TokenType::EQUALS){
-        advance();
-        val = parseExpression();
-    }
+StatementAST* Parser::parseVariableDeclaration(){ //int x = 10;
+    auto decl = parseDeclaration();
     consume(TokenType::SEMICOLON,"';'");
-    return make_unique<VarDeclAST>(type , name , move(val));
+    return decl;
 }
-unique_ptr<StatementAST>Parser::parseAssignmentStatement(){ // x = 5;
-    string name = current().value;
-    advance();
-    consume(TokenType::EQUALS,"'='");
-    auto val = parseExpression();
+StatementAST* Parser::parseAssignmentStatement(){ // x = 5;
+    auto assign = parseUpdate();
     consume(TokenType::SEMICOLON,"';'");
-    return make_unique<AssignmentAST>(name,move(val));
+    return assign;
 }
-unique_ptr<StatementAST>Parser::parseCoutStatement(){
+StatementAST* Parser::parseCoutStatement(){
     advance(); // consume 'cout';
-    auto coutNode = make_unique<CoutStatementAST>();
-    while(current().type == TokenType::STREAM_OPERATOR){
+    auto coutNode = arena->make<CoutStatementAST>();
+    size_t first = exprScratch.size();
+    while(current() == TokenType::STREAM_OPERATOR){
         advance();
-        if(current().type == TokenType::KEYWORD_ENDL){
+        if(current() == TokenType::KEYWORD_ENDL){
             coutNode->hasEndl = true;
             advance();
         }
         else{
             auto expr = parseExpression();
-            coutNode->parts.push_back(move(expr));
+            exprScratch.push_back(expr);
         }
     }
+    coutNode->parts = arena->copy(exprScratch,first);
+    exprScratch.resize(first);
     consume(TokenType::SEMICOLON,"';'");
     return coutNode;
 }
 
-// Parse block{ ... }
-vector<unique_ptr<StatementAST>>Parser::parseBlock(){
-    vector<unique_ptr<StatementAST>>body;
+// Blocks { ... }
+// Instead of parseBlock() recursing into parseStatement(), an open block is a
+// frame on 'blocks'; its statements collect on scratch until the '}' arrives.
+void Parser::openBlock(StatementAST *node,StatementList *body,IfStatementAST *ifNode){
+    if(blocks.size() >= maxDepth) error("blocks nested too deeply (limit "+to_string(maxDepth)+")");
     consume(TokenType::OPEN_BRACE , "'{'");
-    while(current().type != TokenType::CLOSE_BRACE && current().type != TokenType::END_OF_FILE) body.push_back(parseStatement());
-    consume(TokenType::CLOSE_BRACE,"'}'");
-    return body;
+    blocks.push_back({node,body,ifNode,nullptr,scratch.size(),elseIfScratch.size()});
 }
 
-// If / Else If / Else
-unique_ptr<StatementAST>Parser::parseIfStatement(){
-    auto ifNode = make_unique<IfStatementAST>();
-    advance(); // consume 'if'
-    consume(TokenType::OPEN_PAREN,"'('");
-    ifNode->condition = parseComparison();
-    consume(TokenType::CLOSE_PAREN,"')'");
-    ifNode->thenBody = parseBlock();
+StatementAST* Parser::closeBlock(){
+    advance(); // consume '}'
+    OpenBlock &b = blocks.back();
+    StatementList body = arena->copy(scratch,b.firstStmt);
+    scratch.resize(b.firstStmt);
+    if(b.elseIfCondition) elseIfScratch.push_back({b.elseIfCondition,body});
+    else *b.body = body;
+    return nextArm();
+}
 
-    //handle else / else if
-    while(current().type == TokenType::KEYWORD_ELSE){
+StatementAST* Parser::nextArm(){
+    OpenBlock &b = blocks.back();
+    //handle else / else if (nothing may follow a plain else)
+    if(b.ifNode && b.body != &b.ifNode->elseBody && current() == TokenType::KEYWORD_ELSE){
+        inElseHeader = true;
         advance(); // consume 'else'
-        if(current().type == TokenType::KEYWORD_IF){
+        if(current() == TokenType::KEYWORD_IF){
             advance(); // consume else if
             consume(TokenType::OPEN_PAREN,"'('");
-            auto cond = parseComparison();
+            b.elseIfCondition = parseExpression();
             consume(TokenType::CLOSE_PAREN,"')'");
-            auto body = parseBlock();
-            ifNode ->elseIfBlocks.push_back({move(cond),move(body)});
+            b.body = nullptr;
         }
-        else {ifNode->elseBody = parseBlock(); break;}
+        else{
+            b.elseIfCondition = nullptr;
+            b.body = &b.ifNode->elseBody;
+        }
+        consume(TokenType::OPEN_BRACE,"'{'");
+        inElseHeader = false;
+        b.firstStmt = scratch.size();
+        return nullptr;
+    }
+    if(b.ifNode){
+        b.ifNode->elseIfBlocks = arena->copy(elseIfScratch,b.firstElseIf);
+        elseIfScratch.resize(b.firstElseIf);
     }
-    return ifNode;
+    StatementAST *node = b.node;
+    blocks.pop_back();
+    return node;
+}
+
+// If / Else If / Else
+void Parser::parseIfHeader(){
+    auto ifNode = arena->make<IfStatementAST>();
+    advance(); // consume 'if'
+    consume(TokenType::OPEN_PAREN,"'('");
+    ifNode->condition = parseExpression();
+    consume(TokenType::CLOSE_PAREN,"')'");
+    openBlock(ifNode,&ifNode->thenBody,ifNode);
 }
 
 // For Loop
-unique_ptr<StatementAST>Parser::parseForStatement(){
-    auto forNode = make_unique<ForStatementAST>();
+void Parser::parseForHeader(){
+    auto forNode = arena->make<ForStatementAST>();
     advance(); // consume 'for'
     consume(TokenType::OPEN_PAREN,"'('");
-    string init , cond , inc;
-    while(current().type != TokenType::SEMICOLON){init+= current().value + " ";advance();}
+    if(current() == TokenType::KEYWORD_INT || current() == TokenType::KEYWORD_FLOAT) forNode->init = parseDeclaration();
+    else if(current() != TokenType::SEMICOLON) forNode->init = parseUpdate();
     consume(TokenType::SEMICOLON,"';'");
-    while(current().type != TokenType::SEMICOLON){cond+=current().value + " ";advance();}
+    if(current() != TokenType::SEMICOLON) forNode->condition = parseExpression();
     consume(TokenType::SEMICOLON,"';'");
-    while(current().type != TokenType::CLOSE_PAREN){inc+= current().value + " ";advance();}
+    if(current() != TokenType::CLOSE_PAREN) forNode->step = parseUpdate();
     consume(TokenType::CLOSE_PAREN,"')'");
-
-    forNode->init = init; forNode ->condition = cond; forNode ->increment = inc;
-    forNode -> body = parseBlock();
-    return forNode;
+    openBlock(forNode,&forNode->body);
 }
 // While Loop
-unique_ptr<StatementAST>Parser::parseWhileStatement(){
-    auto node = make_unique<WhileStatementAST>();
+void Parser::parseWhileHeader(){
+    auto node = arena->make<WhileStatementAST>();
     advance(); // consume 'while'
     consume(TokenType::OPEN_PAREN,"'('");
-    node->condition = parseComparison();
+    node->condition = parseExpression();
     consume(TokenType::CLOSE_PAREN,"')'");
-    node->body = parseBlock();
-    return node;
+    openBlock(node,&node->body);
 }
 
-unique_ptr<StatementAST> Parser::parseStatement(){
-    switch(current().type){
-        case TokenType::KEYWORD_INT:
-        case TokenType::KEYWORD_FLOAT: return parseVariableDeclaration();
-        case TokenType::IDENTIFIER: return parseAssignmentStatement();
-        case TokenType::KEYWORD_COUT: return parseCoutStatement();
-        case TokenType::KEYWORD_IF:return parseIfStatement();
-        case TokenType::KEYWORD_FOR:return parseForStatement();
-        case TokenType::KEYWORD_WHILE:return parseWhileStatement();
-        default: throw runtime_error("Unexpected token: "+tokenTypeToString(current().type));
+// Panic-mode recovery:
+// skip to just past the next ';', or up to the '}' that closes the enclosing
+// block. A '{' on the way means the broken statement has a body: skip all of it.
+void Parser::synchronize(){
+    size_t depth = 0;
+    for(;;){
+        switch(current()){
+            case TokenType::END_OF_FILE: return;
+            case TokenType::OPEN_BRACE: ++depth; break;
+            case TokenType::CLOSE_BRACE:
+                if(depth == 0){
+                    if(blocks.empty()) advance(); // a stray '}' closes nothing, drop it
+                    return;
+                }
+                if(--depth == 0){ advance(); return; }
+                break;
+            case TokenType::SEMICOLON:
+                if(depth == 0){ advance(); return; }
+                break;
+            default: break;
+        }
+        advance();
     }
 }
 
+// record the error, skip the bad tokens and return the marker that replaces them
+// (nullptr when the marker went into a broken else / else-if arm instead)
+StatementAST* Parser::recover(const runtime_error &e){
+    diagnostics.push_back(e.what());
+    synchronize();
+    StatementAST *marker = arena->make<ErrorStatementAST>(arena->copy(string_view(e.what())));
+    if(!inElseHeader) return marker;
+
+    // the if stays open: the broken arm becomes a marker-only arm, then look for the next one
+    inElseHeader = false;
+    OpenBlock &b = blocks.back();
+    scratch.push_back(marker);
+    elseIfScratch.push_back({nullptr,arena->copy(scratch,scratch.size() - 1)});
+    scratch.pop_back();
+    b.body = nullptr;
+    b.elseIfCondition = nullptr;
+    resumeArm = true;
+    return nullptr;
+}
+
+// one complete statement, including everything nested inside it
+StatementAST* Parser::parseStatement(){
+    for(;;){
+        StatementAST *done = nullptr;
+        try{
+            if(resumeArm){ resumeArm = false; done = nextArm(); }
+            else switch(current()){
+                case TokenType::KEYWORD_INT:
+                case TokenType::KEYWORD_FLOAT: done = parseVariableDeclaration(); break;
+                case TokenType::IDENTIFIER:
+                case TokenType::PLUS_PLUS:
+                case TokenType::MINUS_MINUS: done = parseAssignmentStatement(); break;
+                case TokenType::KEYWORD_COUT: done = parseCoutStatement(); break;
+                case TokenType::KEYWORD_IF: parseIfHeader(); break;
+                case TokenType::KEYWORD_FOR: parseForHeader(); break;
+                case TokenType::KEYWORD_WHILE: parseWhileHeader(); break;
+                case TokenType::CLOSE_BRACE:
+                    if(!blocks.empty()){ done = closeBlock(); break; }
+                    error("Unexpected token: "+tokenTypeToString(current()));
+                default:
+                    if(!blocks.empty() && current() == TokenType::END_OF_FILE){
+                        // close whatever is still open as if the '}'s were there
+                        if(!reportedEof) diagnostics.push_back(located("'}'. Got END_OF_FILE"));
+                        reportedEof = true;
+                        done = closeBlock();
+                        break;
+                    }
+                    error("Unexpected token: "+tokenTypeToString(current()));
+            }
+        }
+        catch(const runtime_error &e){ done = recover(e); }
+        if(!done) continue;
+        if(blocks.empty()) return done;
+        scratch.push_back(done);
+    }
+}
+
+StatementAST* Parser::parseNext(){
+    if(current() == TokenType::END_OF_FILE) return nullptr;
+    return parseStatement();
+}
+
 ProgramAST Parser::parse(){
     ProgramAST prog;
-    while(current().type != TokenType::END_OF_FILE) prog.push_back(parseStatement());
+    while(auto stmt = parseNext()) prog.push_back(stmt);
     return prog;
 }
 // int main(){
@@ -0,0 +1,167 @@
+#ifndef PIPELINE_CPP
+#define PIPELINE_CPP
+#include <bits/stdc++.h>
+#include "parser.cpp"
+using namespace std;
+
+// Pipelined Translation:
+// Lexer, parser, codegen and file writer each run on their own thread and hand
+// work down through bounded single-producer/single-consumer rings, so on a large
+// file the wall-clock time approaches the slowest stage instead of the sum.
+//
+//   lexer --token batches--> parser --statements--> codegen --text chunks--> writer
+//
+// AST memory is recycled: the parser fills one arena at a time from a small
+// pool, and codegen hands each arena back once it has emitted every statement in it.
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+// push() / pop() yield while the ring is full / empty.
+template<class T>
+class SpscRing{
+    vector<T> slots;
+    size_t mask;
+    alignas(64) atomic<size_t> head{0};   // next slot to pop, written by the consumer
+    size_t cachedTail = 0;                // consumer's last look at tail
+    alignas(64) atomic<size_t> tail{0};   // next slot to push, written by the producer
+    size_t cachedHead = 0;                // producer's last look at head
+public:
+    explicit SpscRing(size_t capacity):slots(capacity),mask(capacity - 1){} // capacity: a power of two
+
+    bool tryPush(T &item){
+        size_t t = tail.load(memory_order_relaxed);
+        if(t - cachedHead == slots.size()){
+            cachedHead = head.load(memory_order_acquire);
+            if(t - cachedHead == slots.size()) return false;
+        }
+        slots[t & mask] = move(item);
+        tail.store(t + 1,memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &item){
+        size_t h = head.load(memory_order_relaxed);
+        if(h == cachedTail){
+            cachedTail = tail.load(memory_order_acquire);
+            if(h == cachedTail) return false;
+        }
+        item = move(slots[h & mask]);
+        head.store(h + 1,memory_order_release);
+        return true;
+    }
+
+    void push(T item){ while(!tryPush(item)) this_thread::yield(); }
+    T pop(){
+        T item;
+        while(!tryPop(item)) this_thread::yield();
+        return item;
+    }
+};
+
+// What the parser hands to codegen: a statement, or "arena k is finished"
+// (everything before this in the ring was allocated in it), or the end.
+struct PipelineItem{
+    const StatementAST *stmt = nullptr;
+    int arenaDone = -1;
+};
+
+struct PipelineOptions{
+    size_t maxDepth = 10000;
+    // optional pass over each top-level statement on the parser thread (it may intern
+    // symbols there): appends what the statement becomes, allocating in the given arena
+    function<void(StatementAST*,Arena&,vector<StatementAST*>&)> rewrite;
+    size_t tokenBatch = 4096;          // tokens per lexer -> parser handoff
+    size_t arenaBytes = 8 << 20;       // switch to the next arena once this much is in use
+    size_t outputChunk = 256 << 10;    // bytes of Python per codegen -> writer handoff
+};
+
+// Runs the four stages over lexer's input, calling emit(stmt, out) on the codegen
+// thread to append each top-level statement's Python to out. Symbols are interned
+// into ctx.symbols, which emit may read. Returns the parser's diagnostics.
+template<class Emit>
+vector<string> runPipeline(Lexer &lexer,ParseContext &ctx,ostream &outFile,Emit emit,const PipelineOptions &opt = {}){
+    const int arenaCount = 4;
+    vector<Arena*> arenas = {&ctx.arena};
+    vector<unique_ptr<Arena>> extraArenas;
+    while((int)arenas.size() < arenaCount){
+        extraArenas.push_back(make_unique<Arena>());
+        arenas.push_back(extraArenas.back().get());
+    }
+
+    SpscRing<TokenStream> tokenRing(64);
+    SpscRing<PipelineItem> stmtRing(4096);
+    SpscRing<int> freeArenas(8);
+    SpscRing<string> textRing(16);
+    for(int i = 1 ; i < arenaCount ; ++i) freeArenas.push(i);
+
+    thread lexThread([&]{
+        TokenStream batch;
+        batch.source = lexer.source();
+        for(;;){
+            Token tok = lexer.nextToken();
+            batch.push(tok);
+            bool last = tok.type == TokenType::END_OF_FILE;
+            if(last || batch.size() == opt.tokenBatch){
+                tokenRing.push(move(batch));
+                if(last) return;
+                batch = TokenStream();
+                batch.source = lexer.source();
+            }
+        }
+    });
+
+    vector<string> errors;
+    thread parseThread([&]{
+        Parser parser(lexer.source(),[&](TokenStream &into){ into.append(tokenRing.pop()); },ctx);
+        parser.setMaxDepth(opt.maxDepth);
+        int current = 0;
+        parser.useArena(*arenas[current]);
+        vector<StatementAST*> rewritten;
+        while(auto stmt = parser.parseNext()){
+            if(opt.rewrite){
+                rewritten.clear();
+                opt.rewrite(stmt,*arenas[current],rewritten);
+                for(auto *s : rewritten) stmtRing.push({s,-1});
+            }
+            else stmtRing.push({stmt,-1});
+            if(arenas[current]->bytesUsed() >= opt.arenaBytes){
+                stmtRing.push({nullptr,current});
+                current = freeArenas.pop(); // waits until codegen is done with one
+                parser.useArena(*arenas[current]);
+            }
+        }
+        stmtRing.push({nullptr,-1});
+        errors = parser.errors();
+    });
+
+    thread genThread([&]{
+        string chunk;
+        for(;;){
+            PipelineItem item = stmtRing.pop();
+            if(item.stmt) emit(*item.stmt,chunk);
+            else if(item.arenaDone >= 0){
+                arenas[item.arenaDone]->reset();
+                freeArenas.push(item.arenaDone);
+            }
+            else break;
+            if(chunk.size() >= opt.outputChunk){
+                textRing.push(move(chunk));
+                chunk = string();
+            }
+        }
+        if(!chunk.empty()) textRing.push(move(chunk));
+        textRing.push(string()); // empty chunk: done
+    });
+
+    // the writer is this thread
+    for(;;){
+        string chunk = textRing.pop();
+        if(chunk.empty()) break;
+        outFile.write(chunk.data(),chunk.size());
+    }
+    lexThread.join();
+    parseThread.join();
+    genThread.join();
+    return errors;
+}
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef SCAN_CPP
+#define SCAN_CPP
+#include <bits/stdc++.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+using namespace std;
+
+// Scanning Kernels:
+// The lexer spends most of its time skipping whitespace, comments and string
+// bodies. These kernels find the next interesting byte 16 (SSE2) or 32 (AVX2)
+// bytes at a time; the scalar versions are the fallback and handle inputs
+// shorter than one vector.
+// Each returns an index into p[0..n), or n if nothing was found.
+
+struct ScanKernels{
+    const char *name;
+    size_t (*findByte)(const char *p,size_t n,char c);  // first p[i] == c
+    size_t (*skipSpaces)(const char *p,size_t n);       // first p[i] that isn't ' ',\t,\n,\v,\f,\r
+    size_t (*findAnyOf)(const char *p,size_t n,char a,char b,char c); // first p[i] in {a,b,c}
+};
+
+inline bool isSpaceByte(char c){
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+size_t findByteScalar(const char *p,size_t n,char c){
+    size_t i = 0;
+    while(i < n && p[i] != c) i++;
+    return i;
+}
+
+size_t skipSpacesScalar(const char *p,size_t n){
+    size_t i = 0;
+    while(i < n && isSpaceByte(p[i])) i++;
+    return i;
+}
+
+size_t findAnyOfScalar(const char *p,size_t n,char a,char b,char c){
+    size_t i = 0;
+    while(i < n && p[i] != a && p[i] != b && p[i] != c) i++;
+    return i;
+}
+
+#ifdef SCAN_X86
+size_t findByteSSE2(const char *p,size_t n,char c){
+    const __m128i needle = _mm_set1_epi8(c);
+    size_t i = 0;
+    for(; i + 16 <= n ; i += 16){
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(p + i));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk,needle));
+        if(mask) return i + __builtin_ctz(mask);
+    }
+    if(i < n && n >= 16){ // tail: one overlapping load ending at n, the overlap is already known not to match
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(p + n - 16));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk,needle));
+        return mask ? n - 16 + __builtin_ctz(mask) : n;
+    }
+    return i + findByteScalar(p + i,n - i,c);
+}
+
+// bit i set where chunk[i] is not whitespace
+inline int nonSpaceMaskSSE2(__m128i chunk){
+    // \t..\r is a contiguous range: (c - '\t') as unsigned <= 4
+    __m128i rel = _mm_sub_epi8(chunk,_mm_set1_epi8('\t'));
+    __m128i inRange = _mm_cmpeq_epi8(_mm_min_epu8(rel,_mm_set1_epi8('\r' - '\t')),rel);
+    __m128i isSpace = _mm_or_si128(inRange,_mm_cmpeq_epi8(chunk,_mm_set1_epi8(' ')));
+    return ~_mm_movemask_epi8(isSpace) & 0xFFFF;
+}
+
+size_t skipSpacesSSE2(const char *p,size_t n){
+    size_t i = 0;
+    for(; i + 16 <= n ; i += 16){
+        int mask = nonSpaceMaskSSE2(_mm_loadu_si128((const __m128i*)(p + i)));
+        if(mask) return i + __builtin_ctz(mask);
+    }
+    if(i < n && n >= 16){
+        int mask = nonSpaceMaskSSE2(_mm_loadu_si128((const __m128i*)(p + n - 16)));
+        return mask ? n - 16 + __builtin_ctz(mask) : n;
+    }
+    return i + skipSpacesScalar(p + i,n - i);
+}
+
+inline int anyOfMaskSSE2(__m128i chunk,char a,char b,char c){
+    __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(chunk,_mm_set1_epi8(a)),_mm_cmpeq_epi8(chunk,_mm_set1_epi8(b)));
+    return _mm_movemask_epi8(_mm_or_si128(hit,_mm_cmpeq_epi8(chunk,_mm_set1_epi8(c))));
+}
+
+size_t findAnyOfSSE2(const char *p,size_t n,char a,char b,char c){
+    size_t i = 0;
+    for(; i + 16 <= n ; i += 16){
+        int mask = anyOfMaskSSE2(_mm_loadu_si128((const __m128i*)(p + i)),a,b,c);
+        if(mask) return i + __builtin_ctz(mask);
+    }
+    if(i < n && n >= 16){
+        int mask = anyOfMaskSSE2(_mm_loadu_si128((const __m128i*)(p + n - 16)),a,b,c);
+        return mask ? n - 16 + __builtin_ctz(mask) : n;
+    }
+    return i + findAnyOfScalar(p + i,n - i,a,b,c);
+}
+
+__attribute__((target("avx2")))
+size_t findByteAVX2(const char *p,size_t n,char c){
+    const __m256i needle = _mm256_set1_epi8(c);
+    size_t i = 0;
+    for(; i + 32 <= n ; i += 32){
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(p + i));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk,needle));
+        if(mask) return i + __builtin_ctz(mask);
+    }
+    if(i < n && n >= 32){
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(p + n - 32));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk,needle));
+        return mask ? n - 32 + __builtin_ctz(mask) : n;
+    }
+    return i + findByteSSE2(p + i,n - i,c);
+}
+
+__attribute__((target("avx2")))
+inline unsigned nonSpaceMaskAVX2(__m256i chunk){
+    __m256i rel = _mm256_sub_epi8(chunk,_mm256_set1_epi8('\t'));
+    __m256i inRange = _mm256_cmpeq_epi8(_mm256_min_epu8(rel,_mm256_set1_epi8('\r' - '\t')),rel);
+    __m256i isSpace = _mm256_or_si256(inRange,_mm256_cmpeq_epi8(chunk,_mm256_set1_epi8(' ')));
+    return ~(unsigned)_mm256_movemask_epi8(isSpace);
+}
+
+__attribute__((target("avx2")))
+size_t skipSpacesAVX2(const char *p,size_t n){
+    size_t i = 0;
+    for(; i + 32 <= n ; i += 32){
+        unsigned mask = nonSpaceMaskAVX2(_mm256_loadu_si256((const __m256i*)(p + i)));
+        if(mask) return i + __builtin_ctz(mask);
+    }
+    if(i < n && n >= 32){
+        unsigned mask = nonSpaceMaskAVX2(_mm256_loadu_si256((const __m256i*)(p + n - 32)));
+        return mask ? n - 32 + __builtin_ctz(mask) : n;
+    }
+    return i + skipSpacesSSE2(p + i,n - i);
+}
+
+__attribute__((target("avx2")))
+inline unsigned anyOfMaskAVX2(__m256i chunk,char a,char b,char c){
+    __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(chunk,_mm256_set1_epi8(a)),_mm256_cmpeq_epi8(chunk,_mm256_set1_epi8(b)));
+    return (unsigned)_mm256_movemask_epi8(_mm256_or_si256(hit,_mm256_cmpeq_epi8(chunk,_mm256_set1_epi8(c))));
+}
+
+__attribute__((target("avx2")))
+size_t findAnyOfAVX2(const char *p,size_t n,char a,char b,char c){
+    size_t i = 0;
+    for(; i + 32 <= n ; i += 32){
+        unsigned mask = anyOfMaskAVX2(_mm256_loadu_si256((const __m256i*)(p + i)),a,b,c);
+        if(mask) return i + __builtin_ctz(mask);
+    }
+    if(i < n && n >= 32){
+        unsigned mask = anyOfMaskAVX2(_mm256_loadu_si256((const __m256i*)(p + n - 32)),a,b,c);
+        return mask ? n - 32 + __builtin_ctz(mask) : n;
+    }
+    return i + findAnyOfSSE2(p + i,n - i,a,b,c);
+}
+#endif
+
+const ScanKernels scalarKernels = {"scalar",findByteScalar,skipSpacesScalar,findAnyOfScalar};
+#ifdef SCAN_X86
+const ScanKernels sse2Kernels = {"sse2",findByteSSE2,skipSpacesSSE2,findAnyOfSSE2};
+const ScanKernels avx2Kernels = {"avx2",findByteAVX2,skipSpacesAVX2,findAnyOfAVX2};
+#endif
+
+// every kernel set this CPU can run, slowest first
+vector<const ScanKernels*> availableKernels(){
+    vector<const ScanKernels*> kernels = {&scalarKernels};
+#ifdef SCAN_X86
+    if(__builtin_cpu_supports("sse2")) kernels.push_back(&sse2Kernels);
+    if(__builtin_cpu_supports("avx2")) kernels.push_back(&avx2Kernels);
+#endif
+    return kernels;
+}
+
+// picked once at startup: the widest kernel set the CPU supports
+const ScanKernels &activeKernels(){
+    static const ScanKernels *best = availableKernels().back();
+    return *best;
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef SOURCE_CPP
+#define SOURCE_CPP
+#include <bits/stdc++.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "scan.cpp"
+using namespace std;
+
+// Source Buffer:
+// Holds the text the Lexer reads from. read() slurps the file into a string,
+// map() mmaps it read-only so huge inputs are paged in by the kernel instead
+// of being copied onto the heap.
+class SourceBuffer{
+    string text;
+    const char *mapped = nullptr;
+    size_t mappedLen = 0;
+
+    void unmap(){
+        if(mapped) munmap((void*)mapped,mappedLen);
+        mapped = nullptr;
+        mappedLen = 0;
+    }
+public:
+    SourceBuffer(){}
+    explicit SourceBuffer(string s):text(move(s)){}
+    ~SourceBuffer(){ unmap(); }
+
+    // tokens and AST nodes point into the buffer, so it can't be copied or moved
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    bool read(const string &path){
+        ifstream in(path,ios::binary);
+        if(!in.is_open()) return false;
+        unmap();
+        stringstream buffer;
+        buffer << in.rdbuf();
+        text = buffer.str();
+        return true;
+    }
+
+    bool map(const string &path){
+        int fd = open(path.c_str(),O_RDONLY);
+        if(fd < 0) return false;
+        struct stat st;
+        if(fstat(fd,&st) != 0){ close(fd); return false; }
+        unmap();
+        text.clear();
+        if(st.st_size > 0){ // mmap of length 0 is an error, an empty file is just an empty view
+            void *p = mmap(nullptr,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+            if(p == MAP_FAILED){ close(fd); return false; }
+            madvise(p,st.st_size,MADV_SEQUENTIAL); // we only ever scan forward
+            mapped = (const char*)p;
+            mappedLen = st.st_size;
+        }
+        close(fd); // the mapping stays valid after the descriptor is closed
+        return true;
+    }
+
+    string_view view() const{
+        if(mapped) return string_view(mapped,mappedLen);
+        return string_view(text);
+    }
+};
+
+// Line Index:
+// Tokens only carry byte offsets. When a diagnostic (or a source map) needs
+// line:col, the line-start table is built once with the SIMD newline scan and
+// every lookup after that is a binary search.
+class LineIndex{
+    string_view source;
+    vector<size_t> lineStarts; // empty until the first lookup
+
+    void build(){
+        const ScanKernels &scan = activeKernels();
+        lineStarts.push_back(0);
+        size_t pos = 0;
+        for(;;){
+            pos += scan.findByte(source.data() + pos,source.size() - pos,'\n');
+            if(pos >= source.size()) break;
+            lineStarts.push_back(++pos);
+        }
+    }
+public:
+    struct Location{ size_t line,column; }; // both 1-based, column counts bytes
+
+    explicit LineIndex(string_view src):source(src){}
+
+    Location locate(size_t offset){
+        if(lineStarts.empty()) build();
+        size_t line = upper_bound(lineStarts.begin(),lineStarts.end(),offset) - lineStarts.begin();
+        return {line,offset - lineStarts[line - 1] + 1};
+    }
+
+    string describe(size_t offset){ // "line:col"
+        Location loc = locate(offset);
+        return to_string(loc.line) + ":" + to_string(loc.column);
+    }
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef SYMBOLS_CPP
+#define SYMBOLS_CPP
+#include <bits/stdc++.h>
+#include "arena.cpp"
+using namespace std;
+
+// Symbol Table:
+// Interns identifiers and literals. Every distinct spelling is stored once and
+// gets a dense 32-bit id, so AST nodes hold a Symbol instead of the text and
+// "same name?" is an integer compare. Later passes can index per-symbol data
+// straight by id.
+//
+// Only one thread may intern, but spellings never move once stored: another
+// thread can look up any id it was handed (through a release/acquire handoff,
+// e.g. pipelined codegen) while the parser keeps interning.
+
+struct Symbol{
+    uint32_t id = 0;
+    bool operator==(Symbol other) const{ return id == other.id; }
+    bool operator!=(Symbol other) const{ return id != other.id; }
+};
+
+class SymbolTable{
+    // open addressing, linear probing. The hash sits next to the id so a probe
+    // touches one cache line and the text is only compared on a full hash match.
+    struct Slot{
+        uint32_t hash = 0;
+        uint32_t idPlusOne = 0; // 0 = empty
+    };
+    Arena text;                // one copy of each distinct spelling, never reset
+    vector<Slot> slots;
+
+    // id -> spelling, in segments that double in size and are never reallocated:
+    // id + firstSegment - 1 has its top bit in position log2(firstSegment) + segment
+    static constexpr int firstSegmentBits = 10;
+    unique_ptr<string_view[]> segments[32 - firstSegmentBits + 1];
+    uint32_t count = 0;
+
+    string_view &name(uint32_t id) const{
+        uint64_t v = (uint64_t)id + (1u << firstSegmentBits);
+        int top = 63 - __builtin_clzll(v);
+        return segments[top - firstSegmentBits][v - (1ull << top)];
+    }
+
+    static uint32_t hashOf(string_view s){ // FNV-1a
+        uint32_t h = 2166136261u;
+        for(unsigned char c : s){ h ^= c; h *= 16777619u; }
+        return h;
+    }
+
+    void grow(){
+        vector<Slot> bigger(max<size_t>(slots.size() * 2,1024));
+        size_t mask = bigger.size() - 1;
+        for(const Slot &slot : slots){
+            if(!slot.idPlusOne) continue;
+            size_t i = slot.hash & mask;
+            while(bigger[i].idPlusOne) i = (i + 1) & mask;
+            bigger[i] = slot;
+        }
+        slots.swap(bigger);
+    }
+public:
+    SymbolTable(){ grow(); }
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    // the id of s, adding it on first sight
+    Symbol intern(string_view s){
+        uint32_t h = hashOf(s);
+        size_t mask = slots.size() - 1;
+        size_t i = h & mask;
+        while(slots[i].idPlusOne){
+            uint32_t id = slots[i].idPlusOne - 1;
+            if(slots[i].hash == h && name(id) == s) return Symbol{id};
+            i = (i + 1) & mask;
+        }
+        uint32_t id = count++;
+        uint64_t v = (uint64_t)id + (1u << firstSegmentBits);
+        if((v & (v - 1)) == 0){ // first id of a new segment
+            int top = 63 - __builtin_clzll(v);
+            segments[top - firstSegmentBits].reset(new string_view[1ull << top]);
+        }
+        name(id) = text.copy(s);
+        slots[i] = {h,id + 1};
+        if((size_t)count * 2 > slots.size()) grow(); // keep the load factor under 1/2
+        return Symbol{id};
+    }
+
+    string_view operator[](Symbol s) const{ return name(s.id); }
+    size_t size() const{ return count; }
+};
+
+#endif